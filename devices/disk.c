@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -41,6 +42,19 @@
 #define DEV_LBA 0x40            /* Linear based addressing. */
 #define DEV_DEV 0x10            /* Select device: 0=master, 1=slave. */
 
+/* Status polling.  Polls start POLL_MIN_US microseconds apart
+   and back off exponentially to POLL_MAX_US, so that a device
+   that is quick to respond is noticed quickly without a slow one
+   costing much CPU. */
+#define POLL_MIN_US 10
+#define POLL_MAX_US 10000
+
+/* The ATA standards say that a disk may take as long as
+   BUSY_TIMEOUT_NS to complete its reset.  We warn after
+   BUSY_WARN_NS. */
+#define BUSY_TIMEOUT_NS (30 * 1000000000LL)
+#define BUSY_WARN_NS (7 * 1000000000LL)
+
 /* Commands.
    Many more are defined but this is the small subset that we
    use. */
@@ -67,7 +81,8 @@ struct channel {
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
-static void reset_channel (struct channel *);
+static void reset_channel_start (struct channel *, bool present[2]);
+static void reset_channel_finish (struct channel *, const bool present[2]);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
@@ -78,6 +93,7 @@ static void output_sector (struct channel *, const void *);
 
 static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
+static void poll_delay (int64_t *delay);
 static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
@@ -86,6 +102,7 @@ static void interrupt_handler (struct intr_frame *);
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
+	bool present[CHANNEL_CNT][2];
 	size_t chan_no;
 
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
@@ -126,8 +143,17 @@ disk_init (void) {
 		/* Register interrupt handler. */
 		intr_register_ext (c->irq, interrupt_handler, c->name);
 
-		/* Reset hardware. */
-		reset_channel (c);
+		/* Start resetting hardware.  Both channels reset at the
+		   same time, so probing takes as long as the slower one. */
+		reset_channel_start (c, present[chan_no]);
+	}
+
+	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
+		struct channel *c = &channels[chan_no];
+		int dev_no;
+
+		/* Wait for the reset to finish. */
+		reset_channel_finish (c, present[chan_no]);
 
 		/* Distinguish ATA hard disks from other devices. */
 		if (check_device_type (&c->devices[0]))
@@ -201,6 +227,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
+	TRACE (DISK_READ_ENTER, (d->channel - channels) * 2 + d->dev_no, sec_no);
 	c = d->channel;
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
@@ -211,6 +238,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	input_sector (c, buffer);
 	d->read_cnt++;
 	lock_release (&c->lock);
+	TRACE (DISK_READ_EXIT);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -225,6 +253,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
+	TRACE (DISK_WRITE_ENTER, (d->channel - channels) * 2 + d->dev_no, sec_no);
 	c = d->channel;
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
@@ -235,17 +264,17 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
 	lock_release (&c->lock);
+	TRACE (DISK_WRITE_EXIT);
 }
 
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
 
-/* Resets an ATA channel and waits for any devices present on it
-   to finish the reset. */
+/* Starts resetting ATA channel C.  Sets PRESENT[] to which
+   devices appear to be attached, for reset_channel_finish(). */
 static void
-reset_channel (struct channel *c) {
-	bool present[2];
+reset_channel_start (struct channel *c, bool present[2]) {
 	int dev_no;
 
 	/* The ATA reset sequence depends on which devices are present,
@@ -275,8 +304,16 @@ reset_channel (struct channel *c) {
 	outb (reg_ctl (c), CTL_SRST);
 	timer_usleep (10);
 	outb (reg_ctl (c), 0);
+}
 
-	timer_msleep (150);
+/* Waits for the devices PRESENT[] on channel C, whose reset was
+   started by reset_channel_start(), to finish the reset.  The
+   ATA standard asks the host to wait 2 ms after clearing SRST
+   before it looks at the status register; after that, we poll
+   instead of sleeping for a fixed time. */
+static void
+reset_channel_finish (struct channel *c, const bool present[2]) {
+	timer_msleep (2);
 
 	/* Wait for device 0 to clear BSY. */
 	if (present[0]) {
@@ -286,13 +323,14 @@ reset_channel (struct channel *c) {
 
 	/* Wait for device 1 to clear BSY. */
 	if (present[1]) {
-		int i;
+		int64_t start = timer_ns ();
+		int64_t delay = POLL_MIN_US;
 
 		select_device (&c->devices[1]);
-		for (i = 0; i < 3000; i++) {
+		while (timer_ns () - start < BUSY_TIMEOUT_NS) {
 			if (inb (reg_nsect (c)) == 1 && inb (reg_lbal (c)) == 1)
 				break;
-			timer_msleep (10);
+			poll_delay (&delay);
 		}
 		wait_while_busy (&c->devices[1]);
 	}
@@ -460,23 +498,41 @@ wait_until_idle (const struct disk *d) {
 static bool
 wait_while_busy (const struct disk *d) {
 	struct channel *c = d->channel;
-	int i;
+	int64_t start = timer_ns ();
+	int64_t delay = POLL_MIN_US;
+	bool warned = false;
+
+	for (;;) {
+		int64_t elapsed;
 
-	for (i = 0; i < 3000; i++) {
-		if (i == 700)
-			printf ("%s: busy, waiting...", d->name);
 		if (!(inb (reg_alt_status (c)) & STA_BSY)) {
-			if (i >= 700)
+			if (warned)
 				printf ("ok\n");
 			return (inb (reg_alt_status (c)) & STA_DRQ) != 0;
 		}
-		timer_msleep (10);
+
+		elapsed = timer_ns () - start;
+		if (elapsed >= BUSY_TIMEOUT_NS)
+			break;
+		if (!warned && elapsed >= BUSY_WARN_NS) {
+			printf ("%s: busy, waiting...", d->name);
+			warned = true;
+		}
+		poll_delay (&delay);
 	}
 
 	printf ("failed\n");
 	return false;
 }
 
+/* Sleeps for *DELAY microseconds before the next status poll,
+   then doubles *DELAY up to POLL_MAX_US. */
+static void
+poll_delay (int64_t *delay) {
+	timer_usleep (*delay);
+	*delay = *delay * 2 < POLL_MAX_US ? *delay * 2 : POLL_MAX_US;
+}
+
 /* Program D's channel so that D is now the selected disk. */
 static void
 select_device (const struct disk *d) {
@@ -2,9 +2,12 @@
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
+#include <stddef.h>
 #include <stdio.h>
 #include "threads/interrupt.h"
+#include "intrinsic.h"
 #include "threads/io.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -17,16 +20,86 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input frequency, in Hz. */
+#define PIT_HZ 1193180
+
+#define NSEC_PER_SEC 1000000000LL
+#define NSEC_PER_TICK (NSEC_PER_SEC / TIMER_FREQ)
+
+/* Number of 8254 counts, about 5 ms, over which timer_calibrate()
+   measures the TSC. */
+#define TSC_CALIBRATE_COUNTS (PIT_HZ / 200)
+
+/* Sleeps shorter than this many nanoseconds spin on the TSC,
+   because blocking would take about as long as the sleep. */
+#define SPIN_NS 20000
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* Number of timer interrupts taken since OS booted.  With
+   tickless idle this falls behind `ticks'. */
+static int64_t interrupts;
+
+/* If false (default), the PIT interrupts on every tick.
+   If true, the idle thread stops the periodic tick until the
+   next sleeping thread is due.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* 8254 counts per timer tick. */
+static uint16_t pit_count;
+
+/* Tickless idle state.  While ONESHOT_TICKS is nonzero, counter
+   0 is in one-shot mode and expires exactly ONESHOT_TICKS tick
+   boundaries after it was armed, instead of interrupting at each
+   of them.  TICKS_CREDITED tells timer_interrupt() that
+   timer_irq_enter() has already accounted for its tick. */
+static int64_t oneshot_ticks;
+static bool ticks_credited;
+
+/* TSC clocksource.  TSC_HZ is the frequency of the time stamp
+   counter, measured against the PIT by timer_calibrate().
+   timer_ns() scales the cycles since TSC_BASE, which was read
+   NS_BASE nanoseconds after boot, by TSC_MULT,
+   a 32.32 fixed-point number of nanoseconds per cycle.  Until
+   calibration, timer_ns() has only tick resolution. */
+static uint64_t tsc_hz;
+static uint64_t tsc_mult;
+static uint64_t tsc_base;
+static int64_t ns_base;
+
+/* Pending high-resolution timers, earliest expiry first. */
+static struct heap hrtimers;
+
+/* High-resolution timer state.  Ticks stay on their usual
+   boundaries: when the earliest hrtimer is due before the next
+   tick, counter 0 is put in one-shot mode to interrupt at its
+   expiry instead, with HR_REST counts left to the tick boundary
+   (HR_ARMED), and then in one-shot mode again for the rest of the
+   tick (TICK_ONESHOT), after which it goes back to periodic. */
+static bool hr_armed;
+static uint16_t hr_rest;
+static bool tick_oneshot;
+
+/* A thread blocked in real_time_sleep(). */
+struct real_time_sleeper {
+	struct hrtimer timer;               /* Wakes the thread. */
+	struct semaphore sema;              /* The thread waits here. */
+};
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+static softirq_func timer_softirq;
+static void pit_set_periodic (void);
+static void pit_set_oneshot (uint16_t count);
+static uint16_t pit_read_count (void);
+static bool pit_expired (void);
+static bool pit_irq_pending (void);
+static void hrtimer_run (void);
+static void hrtimer_program (void);
+static bool expires_earlier (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+static void hrtimer_wake (struct hrtimer *);
 static void real_time_sleep (int64_t num, int32_t denom);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
@@ -36,38 +109,67 @@ void
 timer_init (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_count = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_set_periodic ();
+	heap_init (&hrtimers, expires_earlier, NULL);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+	softirq_register (SOFTIRQ_TIMER, timer_softirq);
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the TSC clocksource by counting TSC cycles while
+   counter 0 counts down TSC_CALIBRATE_COUNTS, polling both
+   instead of waiting for whole ticks.  Counter 0 must be in
+   periodic mode, which it is while the caller keeps the idle
+   thread from running. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	enum intr_level old_level;
+	uint64_t tsc_start, tsc_end;
+	uint64_t counts = 0;
+	uint16_t prev, now;
+	bool pending;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+	/* Read each count together with the TSC, with interrupts off
+	   so that nothing comes between them, but let interrupts in
+	   between reads.  Polls are much closer together than a
+	   counter period, so a count above the previous one means
+	   exactly one reload. */
+	old_level = intr_disable ();
+	prev = pit_read_count ();
+	tsc_start = rdtsc ();
+	intr_set_level (old_level);
+	do {
+		old_level = intr_disable ();
+		now = pit_read_count ();
+		tsc_end = rdtsc ();
+		intr_set_level (old_level);
+
+		counts += prev >= now ? prev - now : prev + pit_count - now;
+		prev = now;
+	} while (counts < TSC_CALIBRATE_COUNTS);
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	old_level = intr_disable ();
+	tsc_hz = (tsc_end - tsc_start) * PIT_HZ / counts;
+	tsc_mult = ((uint64_t) NSEC_PER_SEC << 32) / tsc_hz;
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	/* Anchor the clocksource to the current position within the
+	   tick.  A tick whose interrupt is still pending has already
+	   begun; retry if the counter reloads in between reads. */
+	do {
+		now = pit_read_count ();
+		tsc_base = rdtsc ();
+		pending = pit_irq_pending ();
+		prev = pit_read_count ();
+	} while (prev > now);
+	ns_base = (ticks + pending) * NSEC_PER_TICK
+		+ (int64_t) (pit_count - now) * NSEC_PER_SEC / PIT_HZ;
+	intr_set_level (old_level);
+
+	printf ("%'"PRIu64" TSC cycles/s.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -87,6 +189,65 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted, read
+   from the TSC. */
+int64_t
+timer_ns (void) {
+	if (tsc_mult == 0)
+		return timer_ticks () * NSEC_PER_TICK;
+	return ns_base + (int64_t) (((unsigned __int128) (rdtsc () - tsc_base)
+				* tsc_mult) >> 32);
+}
+
+/* Returns the frequency of the TSC in Hz, or 0 if it has not
+   been calibrated yet. */
+uint64_t
+timer_tsc_hz (void) {
+	return tsc_hz;
+}
+
+/* Initializes TIMER to call FUNC when it expires.  FUNC runs in
+   the timer interrupt handler, so it must not sleep. */
+void
+hrtimer_init (struct hrtimer *timer, hrtimer_func *func) {
+	ASSERT (func != NULL);
+
+	timer->func = func;
+	timer->active = false;
+}
+
+/* Arranges for TIMER, which must not be pending, to expire when
+   timer_ns() reaches EXPIRES, which may already have passed.  The
+   PIT interrupts at that moment if it falls between two ticks,
+   so the resolution is that of the 8254, about a microsecond. */
+void
+hrtimer_start (struct hrtimer *timer, int64_t expires) {
+	enum intr_level old_level = intr_disable ();
+
+	ASSERT (!timer->active);
+
+	timer->expires = expires;
+	timer->active = true;
+	heap_push (&hrtimers, &timer->elem);
+	hrtimer_program ();
+	intr_set_level (old_level);
+}
+
+/* Stops TIMER if it is pending.  Returns true if it was, false
+   if it had already expired or was never started. */
+bool
+hrtimer_cancel (struct hrtimer *timer) {
+	enum intr_level old_level = intr_disable ();
+	bool active = timer->active;
+
+	if (active) {
+		heap_remove (&hrtimers, &timer->elem);
+		timer->active = false;
+	}
+	intr_set_level (old_level);
+	return active;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {
@@ -117,15 +278,125 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Busy-waits for approximately NS nanoseconds.  Works with
+   interrupts off, but returns at once until timer_calibrate() has
+   run. */
+void
+timer_ndelay (int64_t ns) {
+	int64_t end = timer_ns () + ns;
+
+	if (tsc_mult == 0)
+		return;
+	while (timer_ns () < end)
+		barrier ();
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
-	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	printf ("Timer: %"PRId64" ticks, %"PRId64" interrupts\n",
+			timer_ticks (), interrupts);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, stops the periodic tick until the
+   tick WAKEUP, at which the earliest sleeping thread is due, or
+   for as long as the 16-bit counter allows.  The skipped ticks
+   are accounted for by timer_irq_enter() when the CPU is woken,
+   whether by the timer or by another interrupt. */
+void
+timer_idle_enter (int64_t wakeup) {
+	uint16_t left;
+	int64_t max, n;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || oneshot_ticks != 0)
+		return;
+
+	/* Keep ticking for pending high-resolution timers. */
+	if (hr_armed || tick_oneshot || !heap_empty (&hrtimers))
+		return;
+
+	/* Stay aligned to the current tick boundaries: expire LEFT
+	   counts from now, at the next boundary, plus whole ticks. */
+	left = pit_read_count ();
+	max = 1 + (UINT16_MAX - left) / pit_count;
+	n = wakeup - ticks;
+	if (n > max)
+		n = max;
+	if (n < 2)
+		return;
+
+	pit_set_oneshot (left + (n - 1) * pit_count);
+	oneshot_ticks = n;
+}
+
+/* Called on entry to every external interrupt handler.  If the
+   periodic tick was stopped by timer_idle_enter(), accounts for
+   the ticks that have passed since, one thread_tick() each, and
+   resumes ticking from the next tick boundary. */
+void
+timer_irq_enter (void) {
+	uint16_t left;
+	int64_t passed;
+
+	ASSERT (intr_context ());
+
+	if (oneshot_ticks == 0)
+		return;
+
+	left = pit_read_count ();
+	if (left == 0 || pit_expired ()) {
+		/* All of the skipped ticks have passed. */
+		passed = oneshot_ticks;
+		oneshot_ticks = 0;
+		pit_set_periodic ();
+		ticks_credited = true;
+	} else {
+		/* Woken early.  The last tick boundary is LEFT counts
+		   away and the others precede it one tick apart. */
+		int64_t ahead = 1 + (left - 1) / pit_count;
+
+		passed = oneshot_ticks - ahead;
+		pit_set_oneshot (left - (ahead - 1) * pit_count);
+		oneshot_ticks = 1;
+	}
+
+	while (passed-- > 0) {
+		ticks++;
+		thread_tick ();
+	}
+	softirq_raise (SOFTIRQ_TIMER);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
+timer_interrupt (struct intr_frame *args) {
+	interrupts++;
+	profile_sample (args);
+	if (hr_armed && pit_expired ()) {
+		/* Not a tick: a high-resolution timer is due before the
+		   next one.  (If the one-shot has not expired, this is a
+		   tick that was already pending when it was armed.) */
+		hr_armed = false;
+		tick_oneshot = true;
+		pit_set_oneshot (hr_rest);
+		hrtimer_run ();
+		return;
+	}
+	if (tick_oneshot) {
+		tick_oneshot = false;
+		pit_set_periodic ();
+	}
+	if (ticks_credited) {
+		/* timer_irq_enter() has already accounted for the tick,
+		   but an hrtimer may have come due on it. */
+		ticks_credited = false;
+		hrtimer_run ();
+		return;
+	}
+
 	ticks++;
 	thread_tick ();
 
@@ -135,62 +406,161 @@ timer_interrupt (struct intr_frame *args UNUSED) {
 		필요하다면 이것들을 ready list로 이동시킨다.
 		global tick 업데이트.
 	*/
-	thread_wakeup(ticks);
+	softirq_raise (SOFTIRQ_TIMER);
+	hrtimer_run ();
+}
+
+/* Timer softirq.  Wakes the sleeping threads that are due, with
+   interrupts on, after the timer interrupt proper. */
+static void
+timer_softirq (void) {
+	thread_wakeup (timer_ticks ());
+}
+
+/* Fires every high-resolution timer that has expired, then
+   arranges for an interrupt at the next one's expiry if that
+   comes before the next tick. */
+static void
+hrtimer_run (void) {
+	int64_t now = timer_ns ();
+
+	while (!heap_empty (&hrtimers)) {
+		struct hrtimer *timer = heap_entry (heap_top (&hrtimers),
+				struct hrtimer, elem);
+		if (timer->expires > now)
+			break;
+		heap_pop (&hrtimers);
+		timer->active = false;
+		timer->func (timer);
+	}
+	hrtimer_program ();
+}
+
+/* If the earliest pending high-resolution timer expires before
+   the next tick boundary, programs counter 0 to interrupt at its
+   expiry.  Later timers are left to the tick interrupt. */
+static void
+hrtimer_program (void) {
+	struct hrtimer *first;
+	uint16_t left;
+	int64_t delta, count;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (hr_armed || oneshot_ticks != 0 || heap_empty (&hrtimers))
+		return;
+
+	/* A tick interrupt is already pending.  It will call us
+	   again. */
+	if (tick_oneshot && pit_expired ())
+		return;
+
+	first = heap_entry (heap_top (&hrtimers), struct hrtimer, elem);
+	delta = first->expires - timer_ns ();
+	if (delta >= NSEC_PER_TICK)
+		return;
+
+	left = pit_read_count ();
+	count = delta > 0 ? DIV_ROUND_UP (delta * PIT_HZ, NSEC_PER_SEC) : 1;
+	if (count >= left)
+		return;
+
+	pit_set_oneshot (count);
+	hr_rest = left - count;
+	hr_armed = true;
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
+/* Returns true if hrtimer A expires before hrtimer B. */
 static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+expires_earlier (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct hrtimer, elem)->expires
+		< heap_entry (b, struct hrtimer, elem)->expires;
+}
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+/* Programs counter 0 to interrupt once per tick. */
+static void
+pit_set_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, pit_count & 0xff);
+	outb (0x40, pit_count >> 8);
+}
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+/* Programs counter 0 to interrupt once, COUNT counts from now. */
+static void
+pit_set_oneshot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Returns the current value of counter 0. */
+static uint16_t
+pit_read_count (void) {
+	uint8_t lo, hi;
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+	outb (0x43, 0x00);    /* CW: counter 0, latch count. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return (hi << 8) | lo;
+}
+
+/* Returns true if counter 0's output is high, which in one-shot
+   mode means that it has reached its terminal count. */
+static bool
+pit_expired (void) {
+	outb (0x43, 0xe2);    /* Read-back: status only, counter 0. */
+	return (inb (0x40) & 0x80) != 0;
+}
+
+/* Returns true if the timer interrupt has been raised but not
+   yet delivered, according to the master 8259A's interrupt
+   request register. */
+static bool
+pit_irq_pending (void) {
+	outb (0x20, 0x0a);    /* OCW3: read IRR. */
+	return (inb (0x20) & 0x01) != 0;
+}
+
+/* Wakes up the thread sleeping on TIMER in real_time_sleep(). */
+static void
+hrtimer_wake (struct hrtimer *timer) {
+	struct real_time_sleeper *sleeper
+		= (struct real_time_sleeper *) ((uint8_t *) timer
+				- offsetof (struct real_time_sleeper, timer));
+
+	sema_up (&sleeper->sema);
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
 static void
 real_time_sleep (int64_t num, int32_t denom) {
-	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
-
-	   (NUM / DENOM) s
-	   ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
-	   1 s / TIMER_FREQ ticks
-	   */
-	int64_t ticks = num * TIMER_FREQ / denom;
+	/* Convert NUM/DENOM seconds into nanoseconds.  DENOM is a
+	   power of 1000 no greater than 1,000,000,000. */
+	int64_t ns = num * (NSEC_PER_SEC / denom);
+	struct real_time_sleeper sleeper;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
-		/* We're waiting for at least one full timer tick.  Use
-		   timer_sleep() because it will yield the CPU to other
-		   processes. */
-		timer_sleep (ticks);
-	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+	ASSERT (NSEC_PER_SEC % denom == 0);
+	if (ns <= 0)
+		return;
+
+	if (tsc_mult == 0) {
+		/* Not calibrated yet, so only whole ticks are possible. */
+		if (ns >= NSEC_PER_TICK)
+			timer_sleep (ns / NSEC_PER_TICK);
+		return;
+	}
+	if (ns < SPIN_NS) {
+		/* Too short to be worth blocking for. */
+		timer_ndelay (ns);
+		return;
 	}
+
+	/* Block until a high-resolution timer wakes us, yielding the
+	   CPU to other threads meanwhile. */
+	sema_init (&sleeper.sema, 0);
+	hrtimer_init (&sleeper.timer, hrtimer_wake);
+	hrtimer_start (&sleeper.timer, timer_ns () + ns);
+	sema_down (&sleeper.sema);
 }
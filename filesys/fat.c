@@ -45,6 +45,7 @@ fat_init (void) {
 	fat_fs = calloc (1, sizeof (struct fat_fs));
 	if (fat_fs == NULL)
 		PANIC ("FAT init failed");
+	lock_init (&fat_fs->write_lock);
 
 	// Read boot sector from the disk
 	unsigned int *bounce = malloc (DISK_SECTOR_SIZE);
@@ -186,6 +187,7 @@ fat_fs_init (void) {
 cluster_t
 fat_create_chain (cluster_t clst) {
 	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
 	cluster_t new_clst = get_empty_cluster();
 	if (new_clst != 0) {
 		fat_put(new_clst, EOChain);
@@ -193,6 +195,7 @@ fat_create_chain (cluster_t clst) {
 			fat_put(clst, new_clst);
 		}
 	}
+	lock_release (&fat_fs->write_lock);
 	return new_clst;
 }
 
@@ -201,6 +204,7 @@ fat_create_chain (cluster_t clst) {
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
 	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
 	while(clst && clst != EOChain){
 		bitmap_set(fat_bitmap, clst - 1, false);
 		clst = fat_get(clst);
@@ -208,6 +212,7 @@ fat_remove_chain (cluster_t clst, cluster_t pclst) {
 	if (pclst != 0){
 		fat_put(pclst, EOChain);
 	}
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
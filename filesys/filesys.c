@@ -22,7 +22,8 @@ filesys_init (bool format) {
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
 	inode_init ();
-	lock_init(&filesys_lock);
+	file_init ();
+	rwlock_init(&filesys_lock);
 
 #ifdef EFILESYS
 	fat_init ();
@@ -62,7 +63,7 @@ filesys_done (void) {
 bool
 filesys_create (const char *name, off_t initial_size) {
 	bool success = false;
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 
 	// Parse path and get directory
 	struct path* path = parse_filepath(name);
@@ -109,7 +110,7 @@ done:
 	free_path(path);
 
 done_lock:
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 
 	return success;
 }
@@ -121,23 +122,23 @@ done_lock:
  * or if an internal memory allocation fails. */
 struct file *
 filesys_open (const char *name) {
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_read(&filesys_lock);
 
 	// Parse path and get directory
 	struct path* path = parse_filepath(name);
 	if (path->dircount == -1) { // open-empty
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return NULL;
 	}
 	struct dir* dir = find_subdir(path->dirnames, path->dircount);
 	if (dir == NULL) {
 		dir_close(dir);
 		free_path(path);
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return NULL;
 	}
 	if (path->filename == "root") { // open "/"
-		lock_release(&filesys_lock);
+		rwlock_release_read(&filesys_lock);
 		return file_open(inode_open (cluster_to_sector(1)));
 	}
 	// struct dir *dir = dir_open_root ();
@@ -148,7 +149,7 @@ filesys_open (const char *name) {
 
 	dir_close (dir);
 	free_path(path);
-	lock_release(&filesys_lock);
+	rwlock_release_read(&filesys_lock);
 
 	return file_open (inode);
 }
@@ -160,7 +161,7 @@ filesys_open (const char *name) {
 bool
 filesys_remove (const char *name) {
 	bool success = false;
-	lock_acquire(&filesys_lock);
+	rwlock_acquire_write(&filesys_lock);
 
 	// Parse path and get directory
 	struct path* path = parse_filepath(name);
@@ -191,7 +192,7 @@ done:
 	free_path(path);
 
 done_lock:
-	lock_release(&filesys_lock);
+	rwlock_release_write(&filesys_lock);
 
 	return success;
 }
@@ -5,6 +5,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 #ifdef EFILESYS
 	#include "filesys/fat.h"
@@ -44,13 +45,32 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
+ * returns the same `struct inode'.  OPEN_INODES_LOCK protects the
+ * list and the inodes' open_cnt members. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
+
+/* Cache of in-memory inodes. */
+static struct kmem_cache *inode_cache;
+
+static void inode_ctor (void *);
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
+	inode_cache = kmem_cache_create ("inode", sizeof (struct inode),
+			inode_ctor);
+}
+
+/* Constructs an inode in inode_cache.  Its lock outlives each use
+   of the inode, since it is idle whenever the inode is freed. */
+static void
+inode_ctor (void *inode_) {
+	struct inode *inode = inode_;
+
+	rwlock_init (&inode->rwlock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -139,36 +159,46 @@ inode_open (disk_sector_t sector) {
 	struct list_elem *e;
 	struct inode *inode;
 
+	lock_acquire (&open_inodes_lock);
+
 	/* Check whether this inode is already open. */
 	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
 			e = list_next (e)) {
 		inode = list_entry (e, struct inode, elem);
 		if (inode->sector == sector) {
-			inode_reopen (inode);
+			inode->open_cnt++;
+			lock_release (&open_inodes_lock);
 			return inode; 
 		}
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	inode = kmem_cache_alloc (inode_cache);
+	if (inode == NULL) {
+		lock_release (&open_inodes_lock);
 		return NULL;
+	}
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  Read the inode before anyone else can find it
+	   in the list. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	list_push_front (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -188,9 +218,11 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
+	lock_acquire (&open_inodes_lock);
 	if (--inode->open_cnt == 0) {
 		/* Remove from inode list and release lock. */
 		list_remove (&inode->elem);
+		lock_release (&open_inodes_lock);
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) { // 지워져야 할 아이노드라면 할당된 클러스터를 다 반환
@@ -202,8 +234,9 @@ inode_close (struct inode *inode) {
 						bytes_to_sectors (inode->data.length)); 
 			#endif
 		}
-		free (inode); // 아이노드 구조체도 메모리에서 반환
-	}
+		kmem_cache_free (inode_cache, inode); // 아이노드 구조체도 메모리에서 반환
+	} else
+		lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -216,13 +249,18 @@ inode_remove (struct inode *inode) {
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
+ * than SIZE if an error occurs or end of file is reached.
+ *
+ * INODE's lock is held while BUFFER is written.  A user BUFFER must
+ * be present and pinned, since handling a fault on it may need the
+ * same lock to load a page mapped from INODE. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
 
+	rwlock_acquire_read (&inode->rwlock);
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -258,6 +296,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
+	rwlock_release_read (&inode->rwlock);
 	free (bounce);
 
 	return bytes_read;
@@ -267,7 +306,10 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
  * Returns the number of bytes actually written, which may be
  * less than SIZE if end of file is reached or an error occurs.
  * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * growth is not yet implemented.)
+ *
+ * Like inode_read_at(), requires a user BUFFER to be present and
+ * pinned. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
@@ -281,6 +323,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	// 해당 파일이 WRITE 작업을 허용하지 않으면 0을 리턴
 	if (inode->deny_write_cnt) return 0;
 
+	rwlock_acquire_write (&inode->rwlock);
+
 	// 아이노드의 데이터 영역에 충분한 공간이 있는지를 확인
 	disk_sector_t sector_idx = byte_to_sector(inode, offset + size);
 
@@ -377,6 +421,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 #endif
 	free (bounce);
 	disk_write(filesys_disk, inode->sector, &inode->data);  // 데이터를 디스크에 저장
+	rwlock_release_write (&inode->rwlock);
 
 	return bytes_written;
 }
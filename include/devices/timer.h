@@ -1,22 +1,48 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <heap.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Stop the periodic tick while idle?  Set by "-tickless". */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
+uint64_t timer_tsc_hz (void);
 
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
+void timer_ndelay (int64_t nanoseconds);
+
+/* A high-resolution one-shot timer, which calls `func' from the
+   timer interrupt once timer_ns() reaches `expires'. */
+struct hrtimer;
+typedef void hrtimer_func (struct hrtimer *);
+struct hrtimer {
+	int64_t expires;                    /* Expiry time, in timer_ns(). */
+	hrtimer_func *func;                 /* Called on expiry. */
+	bool active;                        /* Pending? */
+	struct heap_elem elem;              /* Element in pending timers. */
+};
+
+void hrtimer_init (struct hrtimer *, hrtimer_func *);
+void hrtimer_start (struct hrtimer *, int64_t expires);
+bool hrtimer_cancel (struct hrtimer *);
+
+void timer_idle_enter (int64_t wakeup);
+void timer_irq_enter (void);
 
 void timer_print_stats (void);
 
@@ -14,6 +14,8 @@ struct file {
 	int dupCount;
 };
 
+void file_init (void);
+
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
@@ -26,7 +26,9 @@ struct path {
     char *pathStart_forFreeing; 
 };
 
-struct lock filesys_lock;
+/* Held for writing to change the directory tree, for reading to
+   look names up in it. */
+struct rwlock filesys_lock;
 
 struct path *parse_filepath (const char *name);
 void free_path(struct path *path);
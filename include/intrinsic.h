@@ -128,4 +128,13 @@ static __inline void write_msr(uint32_t ecx, uint64_t val) {
 			:: "c" (ecx), "d" (edx), "a" (eax) );
 }
 
+/* Returns the time stamp counter, which counts CPU cycles since
+   reset. */
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t edx, eax;
+	__asm __volatile("rdtsc" : "=d" (edx), "=a" (eax));
+	return ((uint64_t) edx << 32) | eax;
+}
+
 #endif /* intrinsic.h */
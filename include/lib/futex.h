@@ -0,0 +1,34 @@
+#ifndef __LIB_FUTEX_H
+#define __LIB_FUTEX_H
+
+/* Operations of the futex system call.
+
+   FUTEX_WAIT: if the int at ADDR still equals VAL, sleeps until
+   woken by FUTEX_WAKE or FUTEX_REQUEUE on ADDR or until TIMEOUT
+   microseconds pass, if TIMEOUT is not negative.  Returns 0 if
+   woken.
+
+   FUTEX_WAKE: wakes up to VAL threads waiting on ADDR, highest
+   priority first, and returns how many it woke.
+
+   FUTEX_REQUEUE: wakes up to VAL threads waiting on ADDR, as
+   FUTEX_WAKE, then moves up to TIMEOUT of the rest to wait on
+   ADDR2 instead, and returns how many it woke or moved.
+
+   A Pintos process has a single thread, so a futex is contended
+   only when it lies in memory that processes share: a file
+   mapping that a child inherited from its parent across fork().
+   Such a futex is matched by file and offset, so FUTEX_WAKE in one
+   process wakes a FUTEX_WAIT in the other.  Any other futex is
+   matched by address space and address, and only its owner can
+   wait on it. */
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_REQUEUE 2
+
+/* Errors returned by the futex system call. */
+#define FUTEX_EINVAL (-1)       /* Bad operation or misaligned address. */
+#define FUTEX_EAGAIN (-2)       /* FUTEX_WAIT: value was not VAL. */
+#define FUTEX_ETIMEDOUT (-3)    /* FUTEX_WAIT: timed out. */
+
+#endif /* lib/futex.h */
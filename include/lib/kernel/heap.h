@@ -0,0 +1,68 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+ *
+ * This is a pairing heap: a heap-ordered multiway tree that
+ * supports insertion and finding the minimum in O(1) time and
+ * removal of the minimum or of an arbitrary element in O(lg n)
+ * amortized time.
+ *
+ * Like the linked list and hash table, the heap does not use
+ * dynamic allocation.  Each structure that can potentially be in
+ * a heap must embed a struct heap_elem member, and the
+ * heap_entry macro converts from a struct heap_elem back to the
+ * structure that contains it.  Refer to lib/kernel/list.h for a
+ * detailed explanation of the technique.
+ *
+ * An element's position depends on the key the less function
+ * compares, so an element's key must not change while it is in a
+ * heap.  To change a key, heap_remove() the element, update it,
+ * and heap_push() it again. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* Leftmost child. */
+	struct heap_elem *next;     /* Right sibling. */
+	struct heap_elem *prev;     /* Left sibling, or parent if leftmost. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B.  The least element
+   is at the top of the heap. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Least element, or NULL if empty. */
+	size_t elem_cnt;            /* Number of elements in heap. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+struct heap_elem *heap_top (struct heap *);
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,29 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Number of buckets in a latency histogram.  Bucket B counts
+   latencies of 2**B to 2**(B+1) - 1 TSC cycles, except that
+   bucket 0 also counts latencies of 0 and the last bucket counts
+   everything longer. */
+#define SCHEDSTAT_BUCKETS 32
+
+/* Scheduling statistics of one thread, as returned by the
+   schedstat system call.  Times are in TSC cycles.
+
+   lock_time and lock_hist add up the thread's waits on all locks
+   together.  They tell how long a thread was held up, not by
+   which lock; "-lockstat" breaks waits down by lock. */
+struct schedstat {
+	uint64_t run_time;                  /* Time spent running. */
+	uint64_t wait_time;                 /* Time spent ready, not running. */
+	uint64_t lock_time;                 /* Time blocked in lock_acquire(). */
+	uint64_t voluntary_switches;        /* Switches away while blocking. */
+	uint64_t involuntary_switches;      /* Switches away while runnable. */
+	uint64_t donations;                 /* Priority donations received. */
+	uint32_t wait_hist[SCHEDSTAT_BUCKETS];  /* Run-queue latencies. */
+	uint32_t lock_hist[SCHEDSTAT_BUCKETS];  /* Lock wait latencies. */
+};
+
+#endif /* lib/schedstat.h */
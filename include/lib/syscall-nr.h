@@ -36,6 +36,12 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Scheduling statistics. */
+	SYS_SCHEDSTAT,              /* Reads a thread's scheduling statistics. */
+
+	/* User-space synchronization. */
+	SYS_FUTEX,                  /* Waits on or wakes a futex. */
 };
 
 #endif /* lib/syscall-nr.h */
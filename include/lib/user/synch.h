@@ -0,0 +1,38 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Mutex.
+ *
+ * Locking and unlocking an uncontended mutex takes a single
+ * atomic instruction and no system call; only threads that have
+ * to wait enter the kernel, through the futex system call. */
+struct mutex {
+	int state;                  /* 0: unlocked, 1: locked,
+	                               2: locked, maybe with waiters. */
+};
+
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable. */
+struct condvar {
+	int seq;                    /* Bumped by each signal or broadcast. */
+	struct mutex *mutex;        /* Mutex of the last waiter. */
+};
+
+#define CONDVAR_INITIALIZER { 0, NULL }
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+bool condvar_timedwait (struct condvar *, struct mutex *, int64_t timeout_us);
+void condvar_signal (struct condvar *);
+void condvar_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <schedstat.h>
+#include <stdint.h>
+#include <futex.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +53,10 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Scheduling statistics. */
+bool schedstat (pid_t, struct schedstat *);
+int futex (int *addr, int op, int val, int64_t timeout, int *addr2);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
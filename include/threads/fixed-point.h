@@ -0,0 +1,78 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* 17.14 fixed-point real numbers, as used by the 4.4BSD
+   scheduler for recent_cpu and load_avg.  The low FP_SHIFT bits
+   of a fixed_t hold the fraction, the next 17 the integer part
+   and the top bit the sign.
+
+   Functions whose names end in _int take an ordinary integer as
+   their second operand.  Multiplication and division of two
+   fixed_t values widen to 64 bits so that the intermediate
+   result cannot overflow. */
+typedef int fixed_t;
+
+#define FP_SHIFT 14                     /* # of fraction bits. */
+#define FP_F (1 << FP_SHIFT)            /* Fixed-point 1. */
+
+/* Converts integer N to fixed point. */
+static inline fixed_t
+fp_from_int (int n) {
+	return n * FP_F;
+}
+
+/* Converts X to an integer, rounding toward zero. */
+static inline int
+fp_to_int (fixed_t x) {
+	return x / FP_F;
+}
+
+/* Converts X to an integer, rounding to nearest. */
+static inline int
+fp_round (fixed_t x) {
+	return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+static inline fixed_t
+fp_add (fixed_t x, fixed_t y) {
+	return x + y;
+}
+
+static inline fixed_t
+fp_sub (fixed_t x, fixed_t y) {
+	return x - y;
+}
+
+static inline fixed_t
+fp_add_int (fixed_t x, int n) {
+	return x + n * FP_F;
+}
+
+static inline fixed_t
+fp_sub_int (fixed_t x, int n) {
+	return x - n * FP_F;
+}
+
+static inline fixed_t
+fp_mul (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * y / FP_F;
+}
+
+static inline fixed_t
+fp_mul_int (fixed_t x, int n) {
+	return x * n;
+}
+
+static inline fixed_t
+fp_div (fixed_t x, fixed_t y) {
+	return ((int64_t) x) * FP_F / y;
+}
+
+static inline fixed_t
+fp_div_int (fixed_t x, int n) {
+	return x / n;
+}
+
+#endif /* threads/fixed-point.h */
@@ -72,6 +72,17 @@ void intr_register_int (uint8_t vec, int dpl, enum intr_level,
 bool intr_context (void);
 void intr_yield_on_return (void);
 
+/* Softirqs: deferred halves of external interrupt handlers.  A
+   lower number runs first. */
+enum softirq {
+	SOFTIRQ_TIMER,              /* Timer wakeups. */
+	SOFTIRQ_CNT
+};
+
+typedef void softirq_func (void);
+softirq_func *softirq_register (enum softirq, softirq_func *);
+void softirq_raise (enum softirq);
+
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
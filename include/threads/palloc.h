@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -11,13 +12,26 @@ enum palloc_flags {
 	PAL_USER = 004              /* User page. */
 };
 
+/* Largest buddy block, 2**PALLOC_MAX_ORDER pages.  Larger
+   palloc_get_multiple() requests are served by a slower scan. */
+#define PALLOC_MAX_ORDER 10
+
 /* Maximum number of pages to put in user pool. */
 extern size_t user_page_limit;
 
+/* Set by "-pallocstat" to print page allocator statistics at
+   power off. */
+extern bool pallocstat_enabled;
+
 uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+bool palloc_extend (void *, size_t page_cnt, size_t new_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_start_zeroing (void);
+void clear_page (void *);
+void copy_page (void *dst, const void *src);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,15 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* Sampling rate in samples per second, or 0 if the profiler is
+   off.  Set by kernel command-line option "-profile". */
+extern int profile_hz;
+
+void profile_start (void);
+void profile_sample (const struct intr_frame *);
+void profile_dump (void);
+
+#endif /* threads/profile.h */
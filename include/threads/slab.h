@@ -0,0 +1,59 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Object caches.
+
+   A kmem_cache hands out objects of a single type.  It carves
+   pages, called "slabs", into as many objects of exactly that
+   size as fit, without rounding the size up to a power of 2 the
+   way malloc() does, and keeps each slab's free objects on a
+   list of its own.
+
+   If the cache has a constructor, it is called once on each
+   object when its slab is created, not on every allocation.
+   kmem_cache_free() must be given objects back in their
+   constructed state, so that for example a lock embedded in an
+   object can be initialized once for the object's lifetime.
+
+   Allocation and freeing take no locks: they only turn off
+   interrupts while they update the cache. */
+typedef void kmem_ctor (void *obj);
+
+struct kmem_cache {
+	const char *name;           /* For statistics. */
+	size_t obj_size;            /* Object size, rounded to alignment. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	size_t obj_ofs;             /* Offset of first object in a slab. */
+	kmem_ctor *ctor;            /* Constructor, or null. */
+
+	struct list partial;        /* Slabs with used and free objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct slab *spare;         /* A slab with no used objects, or null. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs, including the spare. */
+	size_t in_use;              /* Objects allocated now. */
+	size_t in_use_max;          /* Most objects allocated at once. */
+	unsigned long long alloc_cnt;       /* kmem_cache_alloc() calls. */
+	unsigned long long free_cnt;        /* kmem_cache_free() calls. */
+	unsigned long long slab_alloc_cnt;  /* Pages taken from palloc. */
+	unsigned long long fail_cnt;        /* Allocations that failed. */
+
+	struct list_elem elem;      /* Element in list of all caches. */
+};
+
+/* Set by "-slabstat" to print kmem_cache statistics at power off. */
+extern bool slabstat_enabled;
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *) __attribute__ ((malloc));
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_cache_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -0,0 +1,29 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+struct thread;
+
+/* switch_threads()'s stack frame.  These are the registers the
+   System V ABI requires a callee to preserve; everything else is
+   dead across the call, so it need not be saved. */
+struct switch_threads_frame {
+	uint64_t r15;               /*  0: Saved %r15. */
+	uint64_t r14;               /*  8: Saved %r14. */
+	uint64_t r13;               /* 16: Saved %r13. */
+	uint64_t r12;               /* 24: Saved %r12. */
+	uint64_t rbp;               /* 32: Saved %rbp. */
+	uint64_t rbx;               /* 40: Saved %rbx. */
+	void (*rip) (void);         /* 48: Return address. */
+	uint64_t pad;               /* 56: Keeps %rsp ABI-aligned at `rip'. */
+};
+
+/* Switches from CUR, which must be the running thread, to NEXT,
+   which must also be running switch_threads(), or be a new
+   thread whose stack holds a switch_threads_frame. */
+void switch_threads (struct thread *cur, struct thread *next);
+#endif
+
+#endif /* threads/switch.h */
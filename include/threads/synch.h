@@ -1,13 +1,18 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct lock_class;
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
 	struct list waiters;        /* List of waiting threads. */
+	struct lock_class *class;   /* Lockstat class, or null. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -17,10 +22,24 @@ void sema_up (struct semaphore *);
 void sema_self_test (void);
 bool compare_sem_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
 
+/* A thread's hold on a lock, or on an rwlock for reading or
+   writing.  Threads waiting for the lock donate their priority to
+   the holder through it. */
+struct hold {
+	int priority;               /* Highest priority among waiters. */
+	struct heap_elem elem;      /* Element in holder's locks. */
+};
+
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+	/* Priority donation. */
+	struct heap waiters;        /* Threads waiting to acquire, by priority. */
+	struct hold hold;           /* Holder's hold. */
+
+	uint64_t acquired_at;       /* TSC when acquired, for lockstat. */
 };
 
 void lock_init (struct lock *);
@@ -29,6 +48,45 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Readers-writer lock.
+ *
+ * Any number of readers or a single writer may hold an rwlock.
+ * Waiters are granted the lock in priority order, and a writer
+ * goes ahead of readers of the same priority, so that a stream of
+ * readers cannot starve writers.  Threads waiting for the lock
+ * donate priority to the writer or to every reader holding it. */
+struct rwlock {
+	struct thread *writer;      /* Thread holding for writing, if any. */
+	struct list readers;        /* Read holds, as struct rwlock_reader. */
+	int untracked;              /* Readers that had no read hold free. */
+	struct heap read_waiters;   /* Threads waiting to read, by priority. */
+	struct heap write_waiters;  /* Threads waiting to write, by priority. */
+	int priority;               /* Highest priority among waiters. */
+	struct hold hold;           /* Writer's hold. */
+
+	struct lock_class *class;   /* Lockstat class, or null. */
+	uint64_t acquired_at;       /* TSC when writer acquired. */
+};
+
+/* One thread's read hold on an rwlock.  Each thread has a few of
+   these.  A thread that reads more rwlocks than that at once is
+   counted in the rwlock's UNTRACKED member instead, and does not
+   receive donations for it. */
+struct rwlock_reader {
+	struct rwlock *rwlock;      /* Lock held, or null if unused. */
+	struct thread *thread;      /* Reader. */
+	struct list_elem elem;      /* Element in rwlock's readers. */
+	struct hold hold;           /* Reader's hold. */
+	uint64_t acquired_at;       /* TSC when acquired. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+
 /* Condition variable. */
 struct condition {
 	struct list waiters;        /* List of waiting threads. */
@@ -39,6 +97,16 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Lock contention statistics.
+ *
+ * With "-lockstat", every lock, rwlock and semaphore is assigned
+ * a class according to the code that initialized it, and each
+ * class counts acquisitions, acquisitions that had to wait, and
+ * the TSC cycles spent waiting and, for locks and rwlocks,
+ * holding. */
+extern bool lockstat_enabled;
+void lockstat_print (void);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
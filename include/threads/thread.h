@@ -2,10 +2,13 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <schedstat.h>
 #include <stdint.h>
 #include <threads/synch.h>
 #include "threads/interrupt.h"
+#include "threads/fixed-point.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -29,6 +32,18 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Number of distinct thread priorities. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Number of rwlocks a thread may hold for reading at once with
+   priority donation. */
+#define THREAD_READ_HOLDS 4
+
+/* Thread niceness, for the multi-level feedback queue scheduler. */
+#define NICE_MIN -20                    /* Most favorable to others. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least favorable to others. */
+
 // for system call
 #define FDT_PAGES 2                     // pages to allocate for file descriptor tables (thread_create, process_exit)
 #define FDT_COUNT_LIMIT 128             // Limit fdIdx
@@ -57,6 +72,7 @@ typedef int tid_t;
  *           |                                 |
  *           +---------------------------------+
  *           |              magic              |
+ *           |              stack              |
  *           |            intr_frame           |
  *           |                :                |
  *           |                :                |
@@ -97,7 +113,29 @@ struct thread {
 	char name[16];                      /* Name (for debugging purposes). */
 	int priority;                       /* Priority. */
 	int init_priority;                  /* Initial priority. */
-	int64_t tick_to_wake;
+	int64_t tick_to_wake;               /* Tick to wake up at, if sleeping. */
+	struct heap_elem sleep_elem;        /* Element in the sleep heap. */
+	struct list_elem all_elem;          /* List element for all threads list. */
+
+	/* Multi-level feedback queue scheduler (thread_mlfqs). */
+	int nice;                           /* Niceness. */
+	fixed_t recent_cpu;                 /* Recently used CPU time. */
+
+	/* Earliest-deadline-first class (thread_set_deadline()).
+	   All times are in timer ticks. */
+	int64_t dl_runtime;                 /* Budget per period, 0 if not in class. */
+	int64_t dl_deadline;                /* Relative deadline. */
+	int64_t dl_period;                  /* Period. */
+	int64_t dl_abs_deadline;            /* Current absolute deadline. */
+	int64_t dl_budget;                  /* Budget left for current deadline. */
+	int64_t dl_replenish;               /* Tick to replenish at, if throttled. */
+	int dl_misses;                      /* Number of deadlines missed. */
+	bool dl_throttled;                  /* Budget exhausted? */
+	struct heap_elem dl_elem;           /* Element in EDF or throttled heap. */
+
+	/* Scheduling statistics. */
+	struct schedstat stats;             /* Counters and histograms. */
+	uint64_t stat_stamp;                /* TSC at last switch or wakeup. */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
@@ -106,9 +144,16 @@ struct thread {
 	   that the thread is waiting for. */
 	struct lock *wait_on_lock;
 
-	/* List to Consider Multiple Donation */
-	struct list donations;
-	struct list_elem d_elem;
+	/* Rwlock the thread is waiting for, and whether to write. */
+	struct rwlock *wait_on_rwlock;
+	bool wait_to_write;
+
+	/* Holds on locks and rwlocks, ordered by the priority their
+	   waiters donate, to Consider Multiple Donation. */
+	struct heap locks;
+	struct heap_elem d_elem;            /* Element in wait_on_lock's or
+	                                       wait_on_rwlock's waiters. */
+	struct rwlock_reader read_holds[THREAD_READ_HOLDS];
 
 	int exit_status;
 	struct file **fd_table;         /* file descriptor table의 시작주소 */
@@ -137,20 +182,42 @@ struct thread {
 	struct dir *wd;                     /* current working directory */
 #endif
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching */
+	struct intr_frame tf;               /* Context for the first launch. */
+	uint8_t *stack;                     /* Saved stack pointer. */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority, and bit P of `bitmap' is
+   set iff queues[P] is nonempty, so that enqueue, dequeue and
+   finding the highest ready priority all take constant time.
+   Threads of the earliest-deadline-first class are kept apart in
+   `dl_heap', ordered by absolute deadline, which is consulted
+   before any of the priority queues. */
+struct runqueue {
+	struct heap dl_heap;                /* Deadline threads, earliest first. */
+	struct list queues[PRI_CNT];        /* One FIFO list per priority. */
+	uint64_t bitmap;                    /* Nonempty queues. */
+	int count;                          /* Number of threads in queues. */
+};
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, print every thread's scheduling statistics at power
+   off.  Controlled by kernel command-line option "-schedstat". */
+extern bool thread_schedstat;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+bool thread_get_schedstat (tid_t, struct schedstat *);
+void thread_account_lock_wait (uint64_t cycles);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -164,6 +231,9 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+struct file **thread_fdt_alloc (void);
+void thread_fdt_free (struct file **);
+
 void thread_sleep (int64_t ticks);
 void thread_wakeup (int64_t ticks);
 
@@ -178,11 +248,20 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+bool thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period);
+void thread_deadline_yield (void);
+int thread_get_deadline_misses (void);
+
 void do_iret (struct intr_frame *tf);
 
-bool compare_donate_priority(struct list_elem *a, struct list_elem *b, void *aux);
+bool compare_donate_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux);
+bool compare_hold_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux);
 void donate_priority(void);
+void insert_with_lock(struct lock *lock);
 void remove_with_lock(struct lock *lock);
+void insert_with_hold (struct thread *, struct hold *, int priority);
+void remove_with_hold (struct thread *, struct hold *);
+void rwlock_update_priority (struct rwlock *);
 void refresh_priority(void);
 
 #endif /* threads/thread.h */
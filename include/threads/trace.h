@@ -0,0 +1,61 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Static tracepoints.
+
+   TRACE (EVENT, ARG0, ARG1) appends a TSC-stamped record of
+   TRACE_EVENT and up to two arguments to the trace buffer, if
+   tracing was enabled with "-trace".  It may be used anywhere,
+   including in interrupt handlers and with interrupts off, and
+   takes no locks.  Building with -DNO_TRACE compiles the
+   tracepoints out.
+
+   Events that come in _ENTER/_EXIT pairs delimit a span of time
+   on the thread that records them.  utils/trace2json turns the
+   dump that trace_dump() prints at power off into a Chrome trace.
+
+   To add an event, add it here and to trace_events[] in
+   threads/trace.c. */
+enum trace_event {
+	TRACE_SCHEDULE,             /* Switch: next tid, prev status. */
+	TRACE_FAULT_ENTER,          /* Page fault: address, flags. */
+	TRACE_FAULT_EXIT,           /* Address, handled? */
+	TRACE_DISK_READ_ENTER,      /* Disk read: disk, sector. */
+	TRACE_DISK_READ_EXIT,
+	TRACE_DISK_WRITE_ENTER,     /* Disk write: disk, sector. */
+	TRACE_DISK_WRITE_EXIT,
+	TRACE_SYSCALL_ENTER,        /* System call: number, first argument. */
+	TRACE_SYSCALL_EXIT,         /* Number, return value. */
+	TRACE_LOCK_WAIT_ENTER,      /* Contended lock: lock, holder tid. */
+	TRACE_LOCK_WAIT_EXIT,       /* Lock. */
+	TRACE_EVENT_CNT
+};
+
+/* Default size of the trace buffer, in pages. */
+#define TRACE_PAGES 64
+
+/* Set by "-trace" to the size of the trace buffer in pages, or 0
+   if tracing is off.  Once trace_init() has allocated the buffer,
+   trace_enabled is true until trace_dump(). */
+extern int trace_pages;
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_record (enum trace_event, uint64_t arg0, uint64_t arg1);
+void trace_dump (void);
+
+#ifdef NO_TRACE
+#define TRACE(EVENT, ...) ((void) 0)
+#else
+#define TRACE(EVENT, ...) TRACE_ (TRACE_##EVENT, ##__VA_ARGS__, 0, 0)
+#define TRACE_(EVENT, ARG0, ARG1, ...)                                  \
+	do {                                                                \
+		if (trace_enabled)                                              \
+			trace_record (EVENT, (uint64_t) (ARG0), (uint64_t) (ARG1)); \
+	} while (0)
+#endif
+
+#endif /* threads/trace.h */
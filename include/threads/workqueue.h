@@ -0,0 +1,60 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+#include "threads/synch.h"
+
+/* Work queues.
+
+   A work item is a function to be called later by a kernel
+   thread, where it may sleep, take locks and take its time.
+   Interrupt handlers queue work for whatever they cannot do with
+   interrupts off.  Each workqueue has its own worker thread,
+   which runs the queue's work one item at a time, in the order
+   queued, at the queue's priority.
+
+   Like a list element, a struct work is embedded in the structure
+   it works on; the function gets the struct work back and can use
+   its address to find that structure. */
+struct work;
+typedef void work_func (struct work *);
+struct work {
+	work_func *func;                    /* Called by the worker. */
+	bool pending;                       /* In a queue? */
+	struct list_elem elem;              /* Element in queue's works. */
+};
+
+/* A work item that is queued once a delay has passed. */
+struct delayed_work {
+	struct work work;                   /* The work. */
+	struct workqueue *wq;               /* Queue to put it on. */
+	struct hrtimer timer;               /* Expires when the delay ends. */
+};
+
+/* A queue of work and the thread that does it. */
+struct workqueue {
+	const char *name;                   /* Worker thread's name. */
+	struct list works;                  /* Queued struct works. */
+	struct semaphore ready;             /* Count of queued works. */
+};
+
+/* Shared queues, at default and at high priority. */
+extern struct workqueue *system_wq;
+extern struct workqueue *system_highpri_wq;
+
+void workqueue_init (void);
+struct workqueue *workqueue_create (const char *name, int priority);
+void flush_workqueue (struct workqueue *);
+
+void work_init (struct work *, work_func *);
+bool queue_work (struct workqueue *, struct work *);
+
+void delayed_work_init (struct delayed_work *, work_func *);
+bool queue_delayed_work (struct workqueue *, struct delayed_work *,
+		int64_t delay_ns);
+bool cancel_delayed_work (struct delayed_work *);
+
+#endif /* threads/workqueue.h */
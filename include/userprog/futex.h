@@ -0,0 +1,11 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+void futex_init (void);
+int futex_wait (const int *uaddr, int val, int64_t timeout_us);
+int futex_wake (const int *uaddr, int cnt);
+int futex_requeue (const int *uaddr, int cnt, const int *uaddr2, int cnt2);
+
+#endif /* userprog/futex.h */
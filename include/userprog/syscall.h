@@ -1,7 +1,12 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 void syscall_init (void);
+void pin_buffer (void *buffer, size_t size, bool write);
+void unpin_buffer (void *buffer, size_t size);
 // struct lock filesys_lock;
 
 #endif /* userprog/syscall.h */
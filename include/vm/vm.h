@@ -51,6 +51,8 @@ struct page {
 	struct hash_elem hash_elem;
 	bool writable; 
 	int mapped_page_count;  // 매핑에 사용한 페이지 개수 (매핑 해제 시 사용)
+	struct thread *owner;  /* Thread whose page table maps it. */
+	struct list_elem share_elem;  /* Element in frame->pages. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -64,17 +66,28 @@ struct page {
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame".
+ * After fork(), a frame may be mapped by several anonymous pages at once,
+ * read-only, until each of them is written to and gets a copy of its own
+ * (copy-on-write).  PAGES lists them all and REF_CNT counts them; PAGE is
+ * one of them, or null.  Swapping the frame out swaps out all of them.
+ * These members are protected by frame_table_lock. */
 struct frame {
 	void *kva;  // kernel virtual address
 	struct page *page;
 	struct list_elem frame_elem;
+	struct list pages;  /* Pages that map this frame. */
+	int ref_cnt;        /* Number of pages in PAGES. */
+	bool pinned;        /* Being filled; not to be evicted. */
 };
 
+/* A swap slot.  Like a frame, it holds the contents of every page that
+ * shared the frame it was swapped out of; REF_CNT counts them. */
 struct slot
 {
 	struct page *page;
 	uint32_t slot_no;
+	int ref_cnt;
 	struct list_elem swap_elem;
 };
 
@@ -120,17 +133,28 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+void vm_frame_release (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_pin_page (void *va);
+void vm_unpin_page (void *va);
 enum vm_type page_get_type (struct page *page);
 
 unsigned page_hash (const struct hash_elem *p_, void *aux UNUSED);
 bool page_less (const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED);
 void hash_page_destroy(struct hash_elem *e, void *aux);
 
+/* These stay plain locks rather than rwlocks: every holder of either
+ * one changes what it protects, whether by linking a page to a frame,
+ * clearing accessed bits while choosing a victim, pinning, or taking
+ * or releasing a swap slot, so there are no readers to let in
+ * together. */
 struct list frame_table;
 struct lock frame_table_lock;
 
 struct list swap_table;
 struct lock swap_table_lock;
 
+/* Cache of the struct lazy_load_args given to lazy_load_segment(). */
+extern struct kmem_cache *lazy_load_arg_cache;
+
 #endif  /* VM_VM_H */
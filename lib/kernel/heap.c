@@ -0,0 +1,167 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a tree in which every node is no greater
+   than any of its children.  The children of a node are kept in
+   a doubly linked list starting at its `child' member and linked
+   through `next'.  The `prev' member of a leftmost child points
+   to its parent rather than to a sibling, which lets an
+   arbitrary element unlink itself in constant time.  The root's
+   `next' and `prev' are null.
+
+   All of the work is done by meld(), which links two trees by
+   making the greater root the leftmost child of the lesser, and
+   by merge_pairs(), which rebuilds a single tree from the
+   children of a removed node in the classic two passes: meld
+   adjacent pairs left to right, then meld the results right to
+   left.  Both are iterative, so deep heaps cannot overflow the
+   kernel stack. */
+
+static struct heap_elem *meld (struct heap *,
+		struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) {
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->elem_cnt = 0;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = meld (heap, heap->root, elem);
+	heap->elem_cnt++;
+}
+
+/* Removes the least element from HEAP and returns it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) {
+	struct heap_elem *top = heap_top (heap);
+
+	heap->root = merge_pairs (heap, top->child);
+	heap->elem_cnt--;
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	if (elem == heap->root) {
+		heap_pop (heap);
+		return;
+	}
+
+	/* Unlink ELEM, and with it its subtree, from its parent. */
+	ASSERT (elem->prev != NULL);
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->next;
+	else
+		elem->prev->next = elem->next;
+	if (elem->next != NULL)
+		elem->next->prev = elem->prev;
+	elem->next = elem->prev = NULL;
+
+	/* Put ELEM's children back. */
+	heap->root = meld (heap, heap->root, merge_pairs (heap, elem->child));
+	heap->elem_cnt--;
+}
+
+/* Returns the least element in HEAP without removing it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_top (struct heap *heap) {
+	ASSERT (heap != NULL);
+	ASSERT (heap->root != NULL);
+	return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (struct heap *heap) {
+	ASSERT (heap != NULL);
+	return heap->elem_cnt;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (struct heap *heap) {
+	ASSERT (heap != NULL);
+	return heap->root == NULL;
+}
+
+/* Links the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	/* Keep A on top when equal, so that older elements tend to
+	   come out first. */
+	if (heap->less (b, a, heap->aux)) {
+		struct heap_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single tree
+   and returns its root, or a null pointer if FIRST is null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* First pass: meld adjacent pairs from left to right,
+	   collecting the results on PAIRS in reverse order. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL) {
+			b->next = b->prev = NULL;
+			a = meld (heap, a, b);
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* Second pass: meld the pairs from right to left. */
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (heap, root, pairs);
+		pairs = next;
+	}
+
+	return root;
+}
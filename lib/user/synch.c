@@ -0,0 +1,128 @@
+#include <synch.h>
+#include <limits.h>
+#include <stddef.h>
+#include <syscall.h>
+
+/* The mutex follows "Futexes Are Tricky" by Ulrich Drepper: a
+   thread that finds the mutex locked marks it contended (2)
+   before it sleeps, and mutex_unlock() makes the futex system
+   call only if it finds the mark. */
+
+/* Atomically replaces *P by NEW if it equals OLD.  Returns the
+   value *P had. */
+static inline int
+cmpxchg (int *p, int old, int new) {
+	__atomic_compare_exchange_n (p, &old, new, false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	return old;
+}
+
+/* Atomically sets *P to NEW and returns the value it had. */
+static inline int
+xchg (int *p, int new) {
+	return __atomic_exchange_n (p, new, __ATOMIC_ACQUIRE);
+}
+
+/* Initializes MUTEX as unlocked. */
+void
+mutex_init (struct mutex *mutex) {
+	mutex->state = 0;
+}
+
+/* Locks MUTEX, sleeping until it is unlocked if necessary. */
+void
+mutex_lock (struct mutex *mutex) {
+	int c = cmpxchg (&mutex->state, 0, 1);
+
+	if (c == 0)
+		return;
+	if (c != 2)
+		c = xchg (&mutex->state, 2);
+	while (c != 0) {
+		futex (&mutex->state, FUTEX_WAIT, 2, -1, NULL);
+		c = xchg (&mutex->state, 2);
+	}
+}
+
+/* Locks MUTEX if it is unlocked.  Returns true if successful,
+   false if MUTEX was locked. */
+bool
+mutex_trylock (struct mutex *mutex) {
+	return cmpxchg (&mutex->state, 0, 1) == 0;
+}
+
+/* Unlocks MUTEX, which the caller must have locked, and wakes a
+   waiter if there may be one. */
+void
+mutex_unlock (struct mutex *mutex) {
+	if (__atomic_fetch_sub (&mutex->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n (&mutex->state, 0, __ATOMIC_RELEASE);
+		futex (&mutex->state, FUTEX_WAKE, 1, 0, NULL);
+	}
+}
+
+/* Initializes COND. */
+void
+condvar_init (struct condvar *cond) {
+	cond->seq = 0;
+	cond->mutex = NULL;
+}
+
+/* Atomically unlocks MUTEX and waits for COND to be signaled,
+   then locks MUTEX again.  As with kernel condition variables,
+   the caller must recheck its condition after waking up. */
+void
+condvar_wait (struct condvar *cond, struct mutex *mutex) {
+	condvar_timedwait (cond, mutex, -1);
+}
+
+/* As condvar_wait(), but gives up waiting after TIMEOUT_US
+   microseconds, if TIMEOUT_US is not negative.  Returns false if
+   it timed out, true otherwise.  MUTEX is locked again either
+   way. */
+bool
+condvar_timedwait (struct condvar *cond, struct mutex *mutex,
+		int64_t timeout_us) {
+	int seq = __atomic_load_n (&cond->seq, __ATOMIC_RELAXED);
+	int result;
+
+	cond->mutex = mutex;
+	mutex_unlock (mutex);
+
+	/* A signal after we read SEQ changes it, so the wait returns
+	   at once instead of missing the signal. */
+	result = futex (&cond->seq, FUTEX_WAIT, seq, timeout_us, NULL);
+
+	/* A broadcast may have moved us to wait on MUTEX, so other
+	   threads may be waiting there: mark it contended. */
+	while (xchg (&mutex->state, 2) != 0)
+		futex (&mutex->state, FUTEX_WAIT, 2, -1, NULL);
+	return result != FUTEX_ETIMEDOUT;
+}
+
+/* Wakes one thread waiting on COND, if any. */
+void
+condvar_signal (struct condvar *cond) {
+	__atomic_fetch_add (&cond->seq, 1, __ATOMIC_RELEASE);
+	futex (&cond->seq, FUTEX_WAKE, 1, 0, NULL);
+}
+
+/* Wakes all threads waiting on COND.  The caller must hold the
+   mutex the waiters use.  Only one thread is woken; the others
+   are moved to wait on the mutex, so that they do not all wake
+   up only to fight over it. */
+void
+condvar_broadcast (struct condvar *cond) {
+	struct mutex *mutex = cond->mutex;
+
+	__atomic_fetch_add (&cond->seq, 1, __ATOMIC_RELEASE);
+	if (mutex == NULL) {
+		futex (&cond->seq, FUTEX_WAKE, INT_MAX, 0, NULL);
+		return;
+	}
+
+	/* Make sure that unlocking the mutex wakes the threads we
+	   move to it. */
+	__atomic_store_n (&mutex->state, 2, __ATOMIC_RELAXED);
+	futex (&cond->seq, FUTEX_REQUEUE, 1, INT_MAX, &mutex->state);
+}
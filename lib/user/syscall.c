@@ -194,3 +194,13 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+bool
+schedstat (pid_t pid, struct schedstat *st) {
+	return syscall2 (SYS_SCHEDSTAT, pid, st);
+}
+
+int
+futex (int *addr, int op, int val, int64_t timeout, int *addr2) {
+	return syscall5 (SYS_FUTEX, addr, op, val, timeout, addr2);
+}
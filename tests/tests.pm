@@ -153,6 +153,11 @@ sub compare_output {
 	delete $options{IGNORE_EXIT_CODES};
 	@output = grep (!/^[a-zA-Z0-9-_]+: exit\(\-?\d+\)$/, @output);
     }
+    my $ignore_timings = exists $options{IGNORE_TIMINGS};
+    if ($ignore_timings) {
+	delete $options{IGNORE_TIMINGS};
+	@output = grep (!/^\([a-zA-Z0-9-_]+\) timing: /, @output);
+    }
     my $ignore_user_faults = exists $options{IGNORE_USER_FAULTS};
     if ($ignore_user_faults) {
 	delete $options{IGNORE_USER_FAULTS};
@@ -0,0 +1,57 @@
+/* Checks sleeps shorter than a timer tick.
+
+   Sleeps for SLEEP_US microseconds SLEEP_CNT times, timing each
+   sleep with timer_ns().  No sleep may end early, and on average
+   they should overshoot by much less than a tick.  The sleeping
+   thread should also leave most of the CPU idle meanwhile, rather
+   than spinning until its time is up. */
+
+#include <stdio.h>
+#include <schedstat.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 40
+#define SLEEP_US 500
+
+void
+test_alarm_usleep (void) 
+{
+  struct schedstat before, after;
+  int64_t start, total_ns, over_ns = 0;
+  uint64_t run_cycles, wall_cycles;
+  int i;
+
+  msg ("Sleeping %d times for %d us.", SLEEP_CNT, SLEEP_US);
+
+  thread_get_schedstat (thread_tid (), &before);
+  start = timer_ns ();
+  for (i = 0; i < SLEEP_CNT; i++) 
+    {
+      int64_t then = timer_ns ();
+      int64_t slept;
+
+      timer_usleep (SLEEP_US);
+      slept = timer_ns () - then;
+      if (slept < SLEEP_US * 1000)
+        fail ("sleep %d lasted only %lld ns", i, slept);
+      over_ns += slept - SLEEP_US * 1000;
+    }
+  total_ns = timer_ns () - start;
+  thread_get_schedstat (thread_tid (), &after);
+  msg ("No sleep ended early.");
+
+  if (over_ns / SLEEP_CNT >= 1000000000 / TIMER_FREQ / 2)
+    fail ("sleeps overshot by %lld ns on average", over_ns / SLEEP_CNT);
+  msg ("Sleeps overshot by less than half a tick on average.");
+
+  /* Our running time is only brought up to date when we are
+     switched out, which we are at every sleep. */
+  run_cycles = after.run_time - before.run_time;
+  wall_cycles = (uint64_t) total_ns * timer_tsc_hz () / 1000000000;
+  if (run_cycles * 2 >= wall_cycles)
+    fail ("ran for %llu of %llu cycles while sleeping",
+          run_cycles, wall_cycles);
+  msg ("Sleeping took less than half of the CPU.");
+}
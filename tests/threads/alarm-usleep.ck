@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-usleep) begin
+(alarm-usleep) Sleeping 40 times for 500 us.
+(alarm-usleep) No sleep ended early.
+(alarm-usleep) Sleeps overshot by less than half a tick on average.
+(alarm-usleep) Sleeping took less than half of the CPU.
+(alarm-usleep) end
+EOF
+pass;
@@ -0,0 +1,117 @@
+/* Checks the earliest-deadline-first class.
+
+   Admission control must refuse a reservation that would take
+   the total bandwidth of deadline threads past the limit, and
+   accept one that fits.  Then, with a thread of the highest
+   ordinary priority spinning the whole time, two periodic
+   threads that stay within their budgets must meet every
+   deadline, while a third that overruns its budget on every job
+   is throttled behind the spinning thread and reported as
+   missing deadlines, without disturbing the other two. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of jobs each deadline thread runs. */
+#define JOB_CNT 5
+
+struct dl_worker 
+  {
+    const char *name;           /* Thread name. */
+    int64_t runtime;            /* Budget per period, in ticks. */
+    int64_t period;             /* Period and deadline, in ticks. */
+    int64_t work;               /* Length of each job, in ticks. */
+    int misses;                 /* Deadlines missed. */
+  };
+
+static thread_func dl_worker_thread;
+static thread_func spin_thread;
+static struct semaphore started, done, spin_done;
+static bool stop;
+
+void
+test_deadline_miss (void) 
+{
+  static struct dl_worker workers[] = 
+    {
+      {"fast", 3, 10, 1, 0},
+      {"slow", 3, 20, 1, 0},
+      {"overrun", 2, 10, 5, 0},
+    };
+  const int worker_cnt = sizeof workers / sizeof *workers;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&started, 0);
+  sema_init (&done, 0);
+  sema_init (&spin_done, 0);
+  stop = false;
+
+  /* The workers reserve 65% of the CPU between them. */
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < worker_cnt; i++)
+    thread_create (workers[i].name, PRI_MAX, dl_worker_thread, &workers[i]);
+  for (i = 0; i < worker_cnt; i++)
+    sema_down (&started);
+
+  if (thread_set_deadline (4, 10, 10))
+    fail ("admitted 40% on top of 65%");
+  msg ("Reservation beyond the bandwidth limit refused.");
+  if (!thread_set_deadline (2, 10, 10))
+    fail ("refused 20% on top of 65%");
+  msg ("Reservation within the bandwidth limit admitted.");
+  if (!thread_set_deadline (0, 0, 0))
+    fail ("could not leave the deadline class");
+
+  thread_create ("spin", PRI_MAX, spin_thread, NULL);
+  for (i = 0; i < worker_cnt; i++)
+    sema_down (&done);
+  stop = true;
+  sema_down (&spin_done);
+
+  for (i = 0; i < worker_cnt; i++)
+    msg ("Thread \"%s\" %s.", workers[i].name,
+         workers[i].misses == 0 ? "met every deadline" : "missed deadlines");
+}
+
+/* Runs JOB_CNT jobs as a deadline thread. */
+static void
+dl_worker_thread (void *w_) 
+{
+  struct dl_worker *w = w_;
+  int i;
+
+  if (!thread_set_deadline (w->runtime, w->period, w->period))
+    fail ("thread \"%s\" refused admission", w->name);
+
+  /* Once throttled, fall behind the spinning thread. */
+  thread_set_priority (PRI_MIN);
+  sema_up (&started);
+
+  for (i = 0; i < JOB_CNT; i++) 
+    {
+      int64_t start = timer_ticks ();
+      while (timer_elapsed (start) < w->work)
+        continue;
+      thread_deadline_yield ();
+    }
+
+  w->misses = thread_get_deadline_misses ();
+  sema_up (&done);
+}
+
+/* Keeps the CPU busy at the highest ordinary priority until told
+   to stop. */
+static void
+spin_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    barrier ();
+  sema_up (&spin_done);
+}
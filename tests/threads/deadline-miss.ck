@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-miss) begin
+(deadline-miss) Reservation beyond the bandwidth limit refused.
+(deadline-miss) Reservation within the bandwidth limit admitted.
+(deadline-miss) Thread "fast" met every deadline.
+(deadline-miss) Thread "slow" met every deadline.
+(deadline-miss) Thread "overrun" missed deadlines.
+(deadline-miss) end
+EOF
+pass;
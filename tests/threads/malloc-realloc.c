@@ -0,0 +1,66 @@
+/* Measures realloc() on buffers that grow a little at a time.
+
+   Grows a buffer from GROW_STEP bytes to SMALL_MAX bytes, across
+   malloc()'s size classes, and another from GROW_STEP bytes to
+   BIG_MAX bytes, across whole pages, GROW_STEP bytes per call.
+   Checks that every call kept the buffer's contents, and reports
+   as timings the average time per call and how many calls moved
+   the buffer, which depend on what else is allocated. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define GROW_STEP 64
+#define SMALL_MAX 2048
+#define BIG_MAX (256 * 1024)
+
+static void grow (const char *name, size_t max_size);
+
+void
+test_malloc_realloc (void)
+{
+  grow ("small", SMALL_MAX);
+  grow ("big", BIG_MAX);
+  pass ();
+}
+
+/* Grows a buffer GROW_STEP bytes at a time up to MAX_SIZE bytes
+   and reports how it went as NAME. */
+static void
+grow (const char *name, size_t max_size)
+{
+  uint8_t *buf = NULL;
+  size_t size, moves = 0, calls = 0;
+  uint64_t start, cycles;
+
+  start = rdtsc ();
+  for (size = GROW_STEP; size <= max_size; size += GROW_STEP)
+    {
+      uint8_t *new_buf = realloc (buf, size);
+      size_t i;
+
+      if (new_buf == NULL)
+        fail ("%s: realloc to %zu bytes failed", name, size);
+      if (buf != NULL && new_buf != buf)
+        moves++;
+      calls++;
+
+      /* Check the old part, and fill in the new part. */
+      for (i = 0; i < size - GROW_STEP; i += GROW_STEP)
+        if (new_buf[i] != (uint8_t) (i / GROW_STEP))
+          fail ("%s: byte %zu lost growing to %zu bytes", name, i, size);
+      new_buf[size - GROW_STEP] = (size - GROW_STEP) / GROW_STEP;
+      buf = new_buf;
+    }
+  cycles = (rdtsc () - start) / calls;
+  free (buf);
+
+  msg ("%s: %zu calls up to %zu bytes kept the contents.",
+       name, calls, max_size);
+  msg ("timing: %s: %zu moved the buffer, %"PRIu64" ns per call.",
+       name, moves, cycles * 1000000000 / timer_tsc_hz ());
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_TIMINGS => 1, [<<'EOF']);
+(malloc-realloc) begin
+(malloc-realloc) small: 32 calls up to 2048 bytes kept the contents.
+(malloc-realloc) big: 4096 calls up to 262144 bytes kept the contents.
+(malloc-realloc) PASS
+(malloc-realloc) end
+EOF
+pass;
@@ -0,0 +1,169 @@
+/* Measures the page allocator.
+
+   First times allocating and freeing blocks of 1, 4 and 64 pages.
+
+   Then fragments the kernel pool the way a mix of single pages
+   and multi-page malloc() blocks would: allocates blocks of
+   random sizes, frees a random half of them, allocates more, and
+   so on, and then frees everything.  Freed pages must have been
+   merged back, so that as many blocks of the largest order can
+   be allocated afterward as before, and a block of every order
+   from 0 up to the largest can be allocated at once.  Finally
+   allocates and frees a run of pages larger than the largest
+   block, which must leave the largest blocks as they were. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define LATENCY_ROUNDS 1000
+#define FRAG_BLOCKS 256                 /* Blocks held at once. */
+#define FRAG_ROUNDS 8
+#define MAX_PAGES ((size_t) 1 << PALLOC_MAX_ORDER)
+#define MAX_BLOCKS 256                  /* Largest blocks to count. */
+#define RUN_PAGES (2 * MAX_PAGES + 1)   /* More than a block holds. */
+
+struct block {
+  void *pages;
+  size_t page_cnt;
+};
+
+static struct block blocks[FRAG_BLOCKS];
+
+static void measure_latency (size_t page_cnt);
+static size_t count_max_blocks (void);
+static void alloc_every_order (void);
+static size_t random_page_cnt (void);
+
+void
+test_palloc_buddy (void)
+{
+  size_t before, after;
+  void *run;
+  int round, i;
+
+  measure_latency (1);
+  measure_latency (4);
+  measure_latency (64);
+
+  before = count_max_blocks ();
+  if (before == 0)
+    fail ("no block of %zu pages free", MAX_PAGES);
+
+  random_init (0);
+  for (round = 0; round < FRAG_ROUNDS; round++)
+    {
+      for (i = 0; i < FRAG_BLOCKS; i++)
+        if (blocks[i].pages == NULL)
+          {
+            blocks[i].page_cnt = random_page_cnt ();
+            blocks[i].pages = palloc_get_multiple (0, blocks[i].page_cnt);
+          }
+      for (i = 0; i < FRAG_BLOCKS; i++)
+        if (random_ulong () % 2)
+          {
+            palloc_free_multiple (blocks[i].pages, blocks[i].page_cnt);
+            blocks[i].pages = NULL;
+          }
+    }
+  for (i = 0; i < FRAG_BLOCKS; i++)
+    {
+      palloc_free_multiple (blocks[i].pages, blocks[i].page_cnt);
+      blocks[i].pages = NULL;
+    }
+
+  after = count_max_blocks ();
+  if (after != before)
+    fail ("%zu blocks of %zu pages free before, %zu after",
+          before, MAX_PAGES, after);
+  msg ("Freed pages merged back into blocks of %zu pages.", MAX_PAGES);
+
+  alloc_every_order ();
+  msg ("Allocated a block of every order from 0 to %d.", PALLOC_MAX_ORDER);
+
+  run = palloc_get_multiple (0, RUN_PAGES);
+  if (run == NULL)
+    fail ("no run of %zu pages", RUN_PAGES);
+  palloc_free_multiple (run, RUN_PAGES);
+  after = count_max_blocks ();
+  if (after != before)
+    fail ("%zu blocks of %zu pages free before a run of %zu pages, "
+          "%zu after", before, MAX_PAGES, RUN_PAGES, after);
+  msg ("Allocated and freed a run of %zu pages.", RUN_PAGES);
+  pass ();
+}
+
+/* Allocates and frees blocks of PAGE_CNT pages LATENCY_ROUNDS
+   times and reports the average time each pair took. */
+static void
+measure_latency (size_t page_cnt)
+{
+  uint64_t start, cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < LATENCY_ROUNDS; i++)
+    {
+      void *pages = palloc_get_multiple (PAL_ASSERT, page_cnt);
+      palloc_free_multiple (pages, page_cnt);
+    }
+  cycles = (rdtsc () - start) / LATENCY_ROUNDS;
+  msg ("timing: %zu pages: %"PRIu64" ns per allocation and free.",
+       page_cnt, cycles * 1000000000 / timer_tsc_hz ());
+}
+
+/* Returns how many blocks of MAX_PAGES pages, up to MAX_BLOCKS,
+   the kernel pool can allocate at once. */
+static size_t
+count_max_blocks (void)
+{
+  static void *max_blocks[MAX_BLOCKS];
+  size_t cnt, i;
+
+  for (cnt = 0; cnt < MAX_BLOCKS; cnt++)
+    {
+      max_blocks[cnt] = palloc_get_multiple (0, MAX_PAGES);
+      if (max_blocks[cnt] == NULL)
+        break;
+    }
+  for (i = 0; i < cnt; i++)
+    palloc_free_multiple (max_blocks[i], MAX_PAGES);
+  return cnt;
+}
+
+/* Allocates a block of every order from 0 to PALLOC_MAX_ORDER,
+   holding them all at once, and then frees them. */
+static void
+alloc_every_order (void)
+{
+  void *orders[PALLOC_MAX_ORDER + 1];
+  int order;
+
+  for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+    {
+      orders[order] = palloc_get_multiple (0, (size_t) 1 << order);
+      if (orders[order] == NULL)
+        fail ("no block of order %d", order);
+    }
+  for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+    palloc_free_multiple (orders[order], (size_t) 1 << order);
+}
+
+/* Returns a block size: mostly single pages, sometimes a few
+   pages, now and then a big block. */
+static size_t
+random_page_cnt (void)
+{
+  unsigned long r = random_ulong () % 16;
+
+  if (r < 10)
+    return 1;
+  else if (r < 15)
+    return 2 + random_ulong () % 7;
+  else
+    return 16 + random_ulong () % 17;
+}
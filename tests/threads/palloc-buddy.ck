@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_TIMINGS => 1, [<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Freed pages merged back into blocks of 1024 pages.
+(palloc-buddy) Allocated a block of every order from 0 to 10.
+(palloc-buddy) Allocated and freed a run of 2049 pages.
+(palloc-buddy) PASS
+(palloc-buddy) end
+EOF
+pass;
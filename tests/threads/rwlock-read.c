@@ -0,0 +1,180 @@
+/* Checks readers-writer locks.
+
+   First, READER_CNT threads each hold a lock for READ_TICKS
+   while they "read".  With a plain lock they take turns; with an
+   rwlock held for reading they should all hold it at once and
+   finish in about the time it takes one of them.
+
+   Then checks that a waiting writer keeps new readers of the
+   same priority out, and that a waiting writer donates its
+   priority to every reader holding the lock. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 8
+#define READ_TICKS 10
+
+struct read_bench {
+  bool use_rwlock;              /* Read through RWLOCK or LOCK? */
+  struct lock lock;
+  struct rwlock rwlock;
+  int active;                   /* Readers holding the lock now. */
+  int max_active;               /* Most readers holding it at once. */
+  struct semaphore done;        /* Up'd by each reader at exit. */
+};
+
+static thread_func bench_reader;
+static int64_t run_bench (struct read_bench *, bool use_rwlock);
+static thread_func writer_func;
+static thread_func reader_func;
+static thread_func holder_func;
+
+static struct rwlock rwlock;
+static struct semaphore ready, go, done;
+static struct thread *holders[2];
+
+void
+test_rwlock_read (void)
+{
+  struct read_bench bench;
+  int64_t lock_ticks, rwlock_ticks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_ticks = run_bench (&bench, false);
+  msg ("%d readers, lock: at most %d at once.",
+       READER_CNT, bench.max_active);
+  if (lock_ticks < READER_CNT * READ_TICKS)
+    fail ("readers took %"PRId64" ticks, expected at least %d",
+          lock_ticks, READER_CNT * READ_TICKS);
+
+  rwlock_ticks = run_bench (&bench, true);
+  msg ("%d readers, rwlock: at most %d at once.",
+       READER_CNT, bench.max_active);
+  if (rwlock_ticks >= 2 * READ_TICKS)
+    fail ("readers took %"PRId64" ticks, expected fewer than %d",
+          rwlock_ticks, 2 * READ_TICKS);
+
+  /* A waiting writer goes ahead of a reader of its priority. */
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_func, NULL);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_func, NULL);
+  thread_yield ();
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  rwlock_release_read (&rwlock);
+  sema_down (&done);
+  sema_down (&done);
+  msg ("writer, reader must already have finished, in that order.");
+
+  /* A waiting writer donates to all the readers. */
+  sema_init (&ready, 0);
+  sema_init (&go, 0);
+  thread_create ("holder 0", PRI_DEFAULT - 1, holder_func, &holders[0]);
+  thread_create ("holder 1", PRI_DEFAULT - 1, holder_func, &holders[1]);
+  sema_down (&ready);
+  sema_down (&ready);
+  thread_create ("writer", PRI_DEFAULT + 5, writer_func, NULL);
+  msg ("Readers should have priority %d.  Actual priorities: %d, %d.",
+       PRI_DEFAULT + 5, holders[0]->priority, holders[1]->priority);
+  sema_up (&go);
+  sema_up (&go);
+  sema_down (&done);
+  sema_down (&done);
+  sema_down (&done);
+  msg ("This should be the last line before finishing this test.");
+}
+
+/* Runs READER_CNT readers through BENCH using an rwlock if
+   USE_RWLOCK, a lock otherwise, and returns how many ticks they
+   took. */
+static int64_t
+run_bench (struct read_bench *bench, bool use_rwlock)
+{
+  int64_t start;
+  int i;
+
+  bench->use_rwlock = use_rwlock;
+  lock_init (&bench->lock);
+  rwlock_init (&bench->rwlock);
+  bench->active = bench->max_active = 0;
+  sema_init (&bench->done, 0);
+
+  start = timer_ticks ();
+  for (i = 0; i < READER_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT + 1, bench_reader, bench);
+    }
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&bench->done);
+  return timer_elapsed (start);
+}
+
+static void
+bench_reader (void *bench_)
+{
+  struct read_bench *bench = bench_;
+
+  if (bench->use_rwlock)
+    rwlock_acquire_read (&bench->rwlock);
+  else
+    lock_acquire (&bench->lock);
+
+  if (++bench->active > bench->max_active)
+    bench->max_active = bench->active;
+  timer_sleep (READ_TICKS);
+  bench->active--;
+
+  if (bench->use_rwlock)
+    rwlock_release_read (&bench->rwlock);
+  else
+    lock_release (&bench->lock);
+  sema_up (&bench->done);
+}
+
+static void
+writer_func (void *aux UNUSED)
+{
+  rwlock_acquire_write (&rwlock);
+  msg ("writer: got the lock");
+  rwlock_release_write (&rwlock);
+  sema_up (&done);
+}
+
+static void
+reader_func (void *aux UNUSED)
+{
+  rwlock_acquire_read (&rwlock);
+  msg ("reader: got the lock");
+  rwlock_release_read (&rwlock);
+  sema_up (&done);
+}
+
+static void
+holder_func (void *holder_)
+{
+  struct thread **holder = holder_;
+
+  rwlock_acquire_read (&rwlock);
+  *holder = thread_current ();
+  sema_up (&ready);
+  sema_down (&go);
+  msg ("%s: priority %d, releasing", thread_name (), thread_get_priority ());
+  rwlock_release_read (&rwlock);
+  sema_up (&done);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-read) begin
+(rwlock-read) 8 readers, lock: at most 1 at once.
+(rwlock-read) 8 readers, rwlock: at most 8 at once.
+(rwlock-read) This thread should have priority 32.  Actual priority: 32.
+(rwlock-read) writer: got the lock
+(rwlock-read) reader: got the lock
+(rwlock-read) writer, reader must already have finished, in that order.
+(rwlock-read) Readers should have priority 36.  Actual priorities: 36, 36.
+(rwlock-read) holder 0: priority 36, releasing
+(rwlock-read) holder 1: priority 36, releasing
+(rwlock-read) writer: got the lock
+(rwlock-read) This should be the last line before finishing this test.
+(rwlock-read) end
+EOF
+pass;
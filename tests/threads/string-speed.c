@@ -0,0 +1,142 @@
+/* Measures the throughput of memcpy(), memmove(), memset(),
+   copy_page() and clear_page(), in bytes per TSC cycle, against
+   a plain byte-at-a-time loop, for blocks of a few sizes.  First
+   checks the results at odd alignments and for overlapping
+   memmove(). */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define BUF_PAGES 16
+#define BUF_SIZE (BUF_PAGES * PGSIZE)
+#define TOTAL_BYTES (4 * 1024 * 1024)   /* Bytes moved per measurement. */
+
+static uint8_t *src, *dst;
+
+static void byte_copy (void *, const void *, size_t);
+static void report (const char *name, size_t size, uint64_t cycles);
+static void check (void);
+
+void
+test_string_speed (void)
+{
+  static const size_t sizes[] = {64, 512, PGSIZE, BUF_SIZE};
+  uint64_t start;
+  size_t i, j;
+
+  src = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  dst = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  for (i = 0; i < BUF_SIZE; i++)
+    src[i] = i * 7;
+
+  check ();
+  msg ("memcpy and memmove match a byte loop at every alignment.");
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i];
+      size_t rounds = TOTAL_BYTES / size;
+
+      start = rdtsc ();
+      for (j = 0; j < rounds; j++)
+        byte_copy (dst, src, size);
+      report ("byte loop", size, rdtsc () - start);
+
+      start = rdtsc ();
+      for (j = 0; j < rounds; j++)
+        memcpy (dst, src, size);
+      report ("memcpy", size, rdtsc () - start);
+
+      start = rdtsc ();
+      for (j = 0; j < rounds; j++)
+        memcpy (dst + 1, src + 3, size - 3);
+      report ("memcpy unaligned", size, rdtsc () - start);
+
+      start = rdtsc ();
+      for (j = 0; j < rounds; j++)
+        memmove (dst + 8, dst, size - 8);
+      report ("memmove overlap", size, rdtsc () - start);
+
+      start = rdtsc ();
+      for (j = 0; j < rounds; j++)
+        memset (dst, j, size);
+      report ("memset", size, rdtsc () - start);
+    }
+
+  start = rdtsc ();
+  for (j = 0; j < TOTAL_BYTES / PGSIZE; j++)
+    copy_page (dst, src);
+  report ("copy_page", PGSIZE, rdtsc () - start);
+
+  start = rdtsc ();
+  for (j = 0; j < TOTAL_BYTES / PGSIZE; j++)
+    clear_page (dst);
+  report ("clear_page", PGSIZE, rdtsc () - start);
+
+  palloc_free_multiple (src, BUF_PAGES);
+  palloc_free_multiple (dst, BUF_PAGES);
+  pass ();
+}
+
+/* Copies SIZE bytes from SRC_ to DST_ one at a time, the way
+   memcpy() used to. */
+static void
+byte_copy (void *dst_, const void *src_, size_t size)
+{
+  uint8_t *d = dst_;
+  const uint8_t *s = src_;
+
+  while (size-- > 0)
+    *d++ = *s++;
+}
+
+/* Reports NAME's throughput for SIZE-byte blocks, given that
+   moving TOTAL_BYTES bytes took CYCLES cycles. */
+static void
+report (const char *name, size_t size, uint64_t cycles)
+{
+  uint64_t bytes = TOTAL_BYTES / size * size;
+  uint64_t hundredths = cycles > 0 ? bytes * 100 / cycles : 0;
+
+  msg ("timing: %s, %zu bytes: %"PRIu64".%02"PRIu64" bytes/cycle",
+       name, size, hundredths / 100, hundredths % 100);
+}
+
+/* Checks memcpy(), memmove() and memset() at every alignment of
+   source and destination and a range of sizes, against
+   byte-at-a-time results. */
+static void
+check (void)
+{
+  size_t src_ofs, dst_ofs, size, i;
+
+  for (src_ofs = 0; src_ofs < 8; src_ofs++)
+    for (dst_ofs = 0; dst_ofs < 8; dst_ofs++)
+      for (size = 0; size < 200; size += 13)
+        {
+          memset (dst, 0xa5, 256);
+          memcpy (dst + dst_ofs, src + src_ofs, size);
+          for (i = 0; i < 256; i++)
+            {
+              uint8_t want = (i >= dst_ofs && i < dst_ofs + size
+                              ? src[i - dst_ofs + src_ofs] : 0xa5);
+              if (dst[i] != want)
+                fail ("memcpy of %zu bytes from +%zu to +%zu: "
+                      "byte %zu wrong", size, src_ofs, dst_ofs, i);
+            }
+
+          /* Move up and then back down, overlapping. */
+          byte_copy (dst, src, 256);
+          memmove (dst + dst_ofs + 1, dst + src_ofs, size);
+          memmove (dst + src_ofs, dst + dst_ofs + 1, size);
+          for (i = 0; i < size; i++)
+            if (dst[src_ofs + i] != src[src_ofs + i])
+              fail ("memmove of %zu bytes between +%zu and +%zu: "
+                    "byte %zu wrong", size, src_ofs, dst_ofs + 1, i);
+        }
+}
@@ -0,0 +1,74 @@
+/* Measures the cost of a context switch.
+
+   The main thread and a partner thread of equal priority take
+   turns on a pair of semaphores for a few seconds, so that every
+   up/down round trip is exactly two thread switches, and reports
+   how many switches per second that came to.  The counts vary
+   from run to run, so they are printed as timings. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Length of the measurement, in seconds. */
+#define PINGPONG_SECONDS 3
+
+static thread_func pingpong_thread;
+static struct semaphore ping, pong;
+static bool done;
+
+void
+test_switch_pingpong (void) 
+{
+  int64_t start, elapsed;
+  long long round_trips = 0;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  done = false;
+  thread_create ("pingpong", thread_get_priority (), pingpong_thread, NULL);
+
+  /* Start on a tick boundary, so that the first tick counts
+     fully. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+
+  while ((elapsed = timer_elapsed (start)) < PINGPONG_SECONDS * TIMER_FREQ) 
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+      round_trips++;
+    }
+
+  done = true;
+  sema_up (&ping);
+  sema_down (&pong);
+
+  msg ("timing: %lld round trips in %lld ticks.", round_trips, elapsed);
+  msg ("timing: %lld thread switches per second.",
+       round_trips * 2 * TIMER_FREQ / elapsed);
+  if (round_trips == 0)
+    fail ("no round trips completed");
+  pass ();
+}
+
+static void
+pingpong_thread (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      sema_down (&ping);
+      if (done)
+        break;
+      sema_up (&pong);
+    }
+  sema_up (&pong);
+}
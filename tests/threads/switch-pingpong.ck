@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_TIMINGS => 1, [<<'EOF']);
+(switch-pingpong) begin
+(switch-pingpong) PASS
+(switch-pingpong) end
+EOF
+pass;
@@ -25,6 +25,14 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"switch-pingpong", test_switch_pingpong},
+    {"deadline-miss", test_deadline_miss},
+    {"alarm-usleep", test_alarm_usleep},
+    {"rwlock-read", test_rwlock_read},
+    {"palloc-buddy", test_palloc_buddy},
+    {"malloc-realloc", test_malloc_realloc},
+    {"string-speed", test_string_speed},
+    {"workqueue", test_workqueue},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
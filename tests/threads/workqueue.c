@@ -0,0 +1,220 @@
+/* Checks workqueues and softirqs.
+
+   Queues work from a high-resolution timer, which runs in the
+   timer interrupt, and checks that it runs in the worker thread.
+   Checks that delayed work runs no sooner than its delay, that
+   delayed work cancelled before its timer fires never runs, and
+   that flush_workqueue() returns only after all the work queued
+   before it has run, in the order queued.
+
+   Finally checks the softirq path: wraps the timer softirq with a
+   function that busy-waits, with interrupts on, until timer
+   interrupts have come in on top of it, and checks that those
+   interrupts did not run softirqs themselves. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define DELAY_MS 20
+#define FLUSH_CNT 16
+
+static struct workqueue *wq;
+static struct semaphore done;
+
+static void test_irq_queue (void);
+static void test_delayed (void);
+static void test_cancel (void);
+static void test_flush (void);
+static void test_softirq (void);
+
+void
+test_workqueue (void)
+{
+  wq = workqueue_create ("wq-test", PRI_DEFAULT);
+  ASSERT (wq != NULL);
+  sema_init (&done, 0);
+
+  test_irq_queue ();
+  test_delayed ();
+  test_cancel ();
+  test_flush ();
+  test_softirq ();
+}
+
+/* Queueing from interrupt context. */
+
+static struct hrtimer irq_timer;
+static struct work irq_work;
+static bool irq_in_context, irq_queued, work_in_thread;
+
+static void
+irq_work_func (struct work *work UNUSED)
+{
+  work_in_thread = !intr_context ();
+  sema_up (&done);
+}
+
+static void
+irq_timer_func (struct hrtimer *timer UNUSED)
+{
+  irq_in_context = intr_context ();
+  irq_queued = queue_work (wq, &irq_work);
+}
+
+static void
+test_irq_queue (void)
+{
+  work_init (&irq_work, irq_work_func);
+  hrtimer_init (&irq_timer, irq_timer_func);
+  hrtimer_start (&irq_timer, timer_ns () + 1000000);
+  sema_down (&done);
+
+  if (!irq_in_context || !irq_queued)
+    fail ("work was not queued from the timer interrupt");
+  if (!work_in_thread)
+    fail ("work ran in interrupt context");
+  msg ("work queued from an interrupt ran in a worker thread");
+}
+
+/* Delayed work. */
+
+static struct delayed_work delayed;
+static int64_t delayed_ran_at;
+static int delayed_runs;
+
+static void
+delayed_func (struct work *work UNUSED)
+{
+  delayed_ran_at = timer_ns ();
+  delayed_runs++;
+  sema_up (&done);
+}
+
+static void
+test_delayed (void)
+{
+  int64_t start;
+
+  delayed_work_init (&delayed, delayed_func);
+  start = timer_ns ();
+  if (!queue_delayed_work (wq, &delayed, DELAY_MS * 1000000LL))
+    fail ("delayed work was not scheduled");
+  if (queue_delayed_work (wq, &delayed, DELAY_MS * 1000000LL))
+    fail ("delayed work was scheduled twice");
+  sema_down (&done);
+
+  if (delayed_ran_at - start < DELAY_MS * 1000000LL)
+    fail ("delayed work ran after %lld ns, before its %d ms delay",
+          delayed_ran_at - start, DELAY_MS);
+  msg ("delayed work ran no sooner than its delay");
+}
+
+static void
+test_cancel (void)
+{
+  delayed_runs = 0;
+  if (!queue_delayed_work (wq, &delayed, DELAY_MS * 1000000LL))
+    fail ("delayed work was not scheduled");
+  if (!cancel_delayed_work (&delayed))
+    fail ("pending delayed work was not cancelled");
+  if (cancel_delayed_work (&delayed))
+    fail ("delayed work was cancelled twice");
+
+  timer_msleep (DELAY_MS * 3);
+  flush_workqueue (wq);
+  if (delayed_runs != 0)
+    fail ("cancelled delayed work ran");
+  msg ("cancelled delayed work did not run");
+}
+
+/* Flushing. */
+
+static struct work flush_works[FLUSH_CNT];
+static int flush_order[FLUSH_CNT];
+static int flush_cnt;
+
+static void
+flush_func (struct work *work)
+{
+  flush_order[flush_cnt++] = work - flush_works;
+}
+
+static void
+test_flush (void)
+{
+  int i;
+
+  for (i = 0; i < FLUSH_CNT; i++)
+    {
+      work_init (&flush_works[i], flush_func);
+      queue_work (wq, &flush_works[i]);
+    }
+  flush_workqueue (wq);
+
+  if (flush_cnt != FLUSH_CNT)
+    fail ("flush returned after %d of %d works", flush_cnt, FLUSH_CNT);
+  for (i = 0; i < FLUSH_CNT; i++)
+    if (flush_order[i] != i)
+      fail ("work %d ran in position %d", flush_order[i], i);
+  msg ("flush waited for %d works, which ran in order", FLUSH_CNT);
+}
+
+/* Softirqs. */
+
+static softirq_func *timer_softirq;
+static volatile bool probe_done;
+static bool probe_intr_on, probe_in_context, probe_nested;
+static int64_t probe_ticks;
+static int softirq_depth;
+
+static void
+probe_softirq (void)
+{
+  if (softirq_depth++ > 0)
+    probe_nested = true;
+
+  if (!probe_done)
+    {
+      int64_t start = timer_ticks ();
+      uint64_t limit = rdtsc () + timer_tsc_hz () / 10;
+
+      probe_intr_on = intr_get_level () == INTR_ON;
+      probe_in_context = intr_context ();
+
+      /* Wait for two ticks' timer interrupts to come in on top of
+         us, giving up after 100 ms. */
+      while (timer_ticks () < start + 2 && rdtsc () < limit)
+        continue;
+      probe_ticks = timer_ticks () - start;
+      probe_done = true;
+    }
+
+  timer_softirq ();
+  softirq_depth--;
+}
+
+static void
+test_softirq (void)
+{
+  timer_softirq = softirq_register (SOFTIRQ_TIMER, probe_softirq);
+  while (!probe_done)
+    timer_msleep (10);
+  timer_msleep (50);
+  softirq_register (SOFTIRQ_TIMER, timer_softirq);
+
+  if (!probe_intr_on)
+    fail ("softirq ran with interrupts off");
+  if (!probe_in_context)
+    fail ("softirq ran outside interrupt context");
+  if (probe_ticks < 2)
+    fail ("no timer interrupt came in during the softirq");
+  if (probe_nested)
+    fail ("softirq ran inside a softirq");
+  msg ("softirq took nested timer interrupts without nesting");
+}
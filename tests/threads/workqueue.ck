@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) work queued from an interrupt ran in a worker thread
+(workqueue) delayed work ran no sooner than its delay
+(workqueue) cancelled delayed work did not run
+(workqueue) flush waited for 16 works, which ran in order
+(workqueue) softirq took nested timer interrupts without nesting
+(workqueue) end
+EOF
+pass;
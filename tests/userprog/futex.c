@@ -0,0 +1,42 @@
+/* Exercises the futex system call and the user-level mutex and
+   condition variable built on it, within a single process.  A
+   process has only one thread, so no futex here is contended:
+   waits can only fail or time out, and wakes find no one.
+   vm/futex-shared covers futexes shared between processes. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int word = 0;
+  struct mutex mutex;
+  struct condvar cond;
+
+  CHECK (futex (&word, FUTEX_WAIT, 1, -1, NULL) == FUTEX_EAGAIN,
+         "wait on a futex whose value changed");
+  CHECK (futex (&word, FUTEX_WAIT, 0, 10000, NULL) == FUTEX_ETIMEDOUT,
+         "wait 10 ms on a futex no one wakes");
+  CHECK (futex (&word, FUTEX_WAKE, 1, 0, NULL) == 0,
+         "wake a futex no one waits on");
+  CHECK (futex ((int *) ((char *) &word + 1), FUTEX_WAKE, 1, 0, NULL)
+         == FUTEX_EINVAL, "wake a misaligned futex");
+
+  mutex_init (&mutex);
+  mutex_lock (&mutex);
+  CHECK (!mutex_trylock (&mutex), "trylock a locked mutex");
+  mutex_unlock (&mutex);
+  CHECK (mutex_trylock (&mutex), "trylock an unlocked mutex");
+
+  condvar_init (&cond);
+  CHECK (!condvar_timedwait (&cond, &mutex, 10000),
+         "wait 10 ms on a condition no one signals");
+  condvar_signal (&cond);
+  condvar_broadcast (&cond);
+  mutex_unlock (&mutex);
+  CHECK (mutex_trylock (&mutex), "mutex is unlocked after broadcast");
+  mutex_unlock (&mutex);
+}
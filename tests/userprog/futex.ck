@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex) begin
+(futex) wait on a futex whose value changed
+(futex) wait 10 ms on a futex no one wakes
+(futex) wake a futex no one waits on
+(futex) wake a misaligned futex
+(futex) trylock a locked mutex
+(futex) trylock an unlocked mutex
+(futex) wait 10 ms on a condition no one signals
+(futex) mutex is unlocked after broadcast
+(futex) end
+futex: exit(0)
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Measures fork() followed by exec() and wait() in a child, first
+   with the parent's 1 MB heap untouched and then with all of it
+   resident.  With copy-on-write, fork() shares the heap's frames
+   instead of copying them, and the child never touches them before
+   exec() throws its address space away, so a resident heap should
+   cost little more than an untouched one. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HEAP_SIZE (1024 * 1024)
+#define ITERATIONS 10
+
+static char heap[HEAP_SIZE];
+
+static uint64_t
+rdtsc (void)
+{
+	uint32_t lo, hi;
+	asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	return (uint64_t) hi << 32 | lo;
+}
+
+/* Runs ITERATIONS fork-exec-wait rounds and returns the average
+   number of cycles each took. */
+static uint64_t
+fork_exec (void)
+{
+	uint64_t start = rdtsc ();
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++) {
+		pid_t child = fork ("child");
+		if (child == 0) {
+			exec ("child-simple");
+			fail ("exec failed");
+		}
+		CHECK (child > 0, "fork");
+		if (wait (child) != 81)
+			fail ("wrong exit status");
+	}
+	return (rdtsc () - start) / ITERATIONS;
+}
+
+void
+test_main (void)
+{
+	uint64_t untouched, resident;
+
+	quiet = true;
+	untouched = fork_exec ();
+	memset (heap, 0xa5, sizeof heap);
+	resident = fork_exec ();
+	quiet = false;
+
+	msg ("untouched heap: %llu cycles per fork-exec",
+			(unsigned long long) untouched);
+	msg ("resident heap: %llu cycles per fork-exec",
+			(unsigned long long) resident);
+	CHECK (heap[0] == (char) 0xa5 && heap[HEAP_SIZE - 1] == (char) 0xa5,
+			"heap intact");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "heap changed under the parent"
+  unless grep ($_ eq '(cow-fork-exec) heap intact', @output);
+fail "missing end in output"
+  unless grep ($_ eq '(cow-fork-exec) end', @output);
+
+pass;
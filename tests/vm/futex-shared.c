@@ -0,0 +1,73 @@
+/* Maps a file, forks, and checks that a futex in the mapping,
+   which the parent and child share, can be waited on in the child
+   and woken, or requeued and then woken, from the parent. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+/* A futex no one wakes, for sleeping. */
+static int nap_word;
+
+/* Sleeps for about MS milliseconds. */
+static void
+nap (int ms)
+{
+  futex (&nap_word, FUTEX_WAIT, 0, ms * 1000, NULL);
+}
+
+void
+test_main (void)
+{
+  int handle;
+  int *word;
+  pid_t child;
+  int status;
+
+  CHECK (create ("futex.dat", 4096), "create \"futex.dat\"");
+  CHECK ((handle = open ("futex.dat")) > 1, "open \"futex.dat\"");
+  CHECK ((word = mmap (ACTUAL, 4096, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"futex.dat\"");
+
+  /* Fault the page in, so that the child shares its frame. */
+  word[0] = word[1] = 0;
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      /* Sleep on word[0] twice; the parent wakes us the first time
+         and requeues us to word[1] the second.  Time out after 10 s
+         rather than hang. */
+      word[0] = 1;
+      if (futex (&word[0], FUTEX_WAIT, 1, 10000000, NULL) != 0)
+        exit (1);
+      word[0] = 2;
+      if (futex (&word[0], FUTEX_WAIT, 2, 10000000, NULL) != 0)
+        exit (2);
+      exit (0);
+    }
+
+  /* Each call finds the child only once it is asleep. */
+  while (word[0] != 1)
+    nap (1);
+  while (futex (&word[0], FUTEX_WAKE, 1, 0, NULL) != 1)
+    nap (1);
+  msg ("woke the child");
+
+  while (word[0] != 2)
+    nap (1);
+  while (futex (&word[0], FUTEX_REQUEUE, 0, 1, &word[1]) != 1)
+    nap (1);
+  msg ("requeued the child");
+  CHECK (futex (&word[0], FUTEX_WAKE, 1, 0, NULL) == 0,
+         "nothing left waiting on the first futex");
+
+  quiet = true;
+  CHECK (futex (&word[1], FUTEX_WAKE, 1, 0, NULL) == 1,
+         "wake the child from the second futex");
+  status = wait (child);
+  quiet = false;
+  CHECK (status == 0, "child was woken both times");
+}
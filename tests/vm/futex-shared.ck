@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(futex-shared) begin
+(futex-shared) create "futex.dat"
+(futex-shared) open "futex.dat"
+(futex-shared) mmap "futex.dat"
+(futex-shared) woke the child
+(futex-shared) requeued the child
+(futex-shared) nothing left waiting on the first futex
+(futex-shared) child was woken both times
+(futex-shared) end
+EOF
+pass;
@@ -1,6 +1,7 @@
 #include "threads/init.h"
 #include <console.h>
 #include <debug.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <random.h>
 #include <stddef.h>
@@ -13,13 +14,19 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -52,6 +59,24 @@ bool power_off_when_done;
 
 bool thread_tests;
 
+/* -bootprof: Print how long each stage of boot took? */
+static bool boot_profile;
+
+/* Boot profiler.  main() calls boot_mark() as each stage of
+   initialization finishes, recording the TSC; print_boot_profile()
+   turns the differences into times once the TSC is calibrated. */
+#define BOOT_STAGE_MAX 24
+struct boot_stage {
+	const char *name;           /* Stage that just finished. */
+	uint64_t tsc;               /* TSC when it finished. */
+};
+static struct boot_stage boot_stages[BOOT_STAGE_MAX];
+static size_t boot_stage_cnt;
+static uint64_t boot_tsc;       /* TSC on entry to main(). */
+
+static void boot_mark (const char *stage);
+static void print_boot_profile (void);
+
 static void bss_init (void);
 static void paging_init (uint64_t mem_end);
 
@@ -68,29 +93,38 @@ int main (void) NO_RETURN;
 /* Pintos main program. */
 int
 main (void) {
+	uint64_t start = rdtsc ();
 	uint64_t mem_end;
 	char **argv;
 
 	/* Clear BSS and get machine's RAM size. */
 	bss_init ();
+	boot_tsc = start;
+	boot_mark ("bss");
 
 	/* Break command line into arguments and parse options. */
 	argv = read_command_line ();
 	argv = parse_options (argv);
+	boot_mark ("command line");
 
 	/* Initialize ourselves as a thread so we can use locks,
 	   then enable console locking. */
 	thread_init ();
 	console_init ();
+	boot_mark ("thread, console");
 
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	trace_init ();
+	boot_mark ("palloc, malloc");
 	paging_init (mem_end);
+	boot_mark ("paging");
 
 #ifdef USERPROG
 	tss_init ();
 	gdt_init ();
+	boot_mark ("tss, gdt");
 #endif
 
 	/* Initialize interrupt handlers. */
@@ -102,22 +136,33 @@ main (void) {
 	exception_init ();
 	syscall_init ();
 #endif
+	boot_mark ("interrupts");
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_init ();
+	palloc_start_zeroing ();
 	serial_init_queue ();
+	boot_mark ("scheduler");
 	timer_calibrate ();
+	profile_start ();
+	boot_mark ("timer calibration");
 
 #ifdef FILESYS
 	/* Initialize file system. */
 	disk_init ();
+	boot_mark ("disks");
 	filesys_init (format_filesys);
 	thread_current()->wd = dir_open_root();
+	boot_mark ("file system");
 #endif
 
 #ifdef VM
 	vm_init ();
+	boot_mark ("vm");
 #endif
 
+	if (boot_profile)
+		print_boot_profile ();
 	printf ("Boot complete.\n");
 
 	/* Run actions specified on kernel command line. */
@@ -129,6 +174,36 @@ main (void) {
 	thread_exit ();
 }
 
+/* Records that boot stage STAGE has just finished. */
+static void
+boot_mark (const char *stage) {
+	if (boot_stage_cnt < BOOT_STAGE_MAX) {
+		boot_stages[boot_stage_cnt].name = stage;
+		boot_stages[boot_stage_cnt].tsc = rdtsc ();
+		boot_stage_cnt++;
+	}
+}
+
+/* Prints the time each boot stage took, in microseconds, or in
+   TSC cycles if the TSC could not be calibrated. */
+static void
+print_boot_profile (void) {
+	uint64_t hz = timer_tsc_hz ();
+	uint64_t prev = boot_tsc;
+	size_t i;
+
+	printf ("Boot profile (%s):\n", hz != 0 ? "us" : "cycles");
+	for (i = 0; i < boot_stage_cnt; i++) {
+		uint64_t cycles = boot_stages[i].tsc - prev;
+
+		printf ("  %-20s %'12"PRIu64"\n", boot_stages[i].name,
+				hz != 0 ? cycles * 1000000 / hz : cycles);
+		prev = boot_stages[i].tsc;
+	}
+	printf ("  %-20s %'12"PRIu64"\n", "total",
+			hz != 0 ? (prev - boot_tsc) * 1000000 / hz : prev - boot_tsc);
+}
+
 /* Clear BSS */
 static void
 bss_init (void) {
@@ -223,6 +298,24 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-schedstat"))
+			thread_schedstat = true;
+		else if (!strcmp (name, "-bootprof"))
+			boot_profile = true;
+		else if (!strcmp (name, "-lockstat"))
+			lockstat_enabled = true;
+		else if (!strcmp (name, "-mallocstat"))
+			mallocstat_enabled = true;
+		else if (!strcmp (name, "-slabstat"))
+			slabstat_enabled = true;
+		else if (!strcmp (name, "-pallocstat"))
+			pallocstat_enabled = true;
+		else if (!strcmp (name, "-trace"))
+			trace_pages = value != NULL ? atoi (value) : TRACE_PAGES;
+		else if (!strcmp (name, "-profile"))
+			profile_hz = value != NULL ? atoi (value) : TIMER_FREQ;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -328,10 +421,21 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -tickless          Stop the timer tick while idle.\n"
+			"  -bootprof          Print the time each boot stage takes.\n"
+			"  -schedstat         Print per-thread scheduling stats at power off.\n"
+			"  -lockstat          Print lock contention stats at power off.\n"
+			"  -mallocstat        Print malloc stats at power off.\n"
+			"  -slabstat          Print object cache stats at power off.\n"
+			"  -pallocstat        Print page allocator stats at power off.\n"
+			"  -trace[=PAGES]     Record tracepoints in a PAGES-page buffer (default\n"
+			"                     %d) and print them at power off.\n"
+			"  -profile[=HZ]      Sample kernel stacks HZ times a second (default\n"
+			"                     %d) and print the samples at power off.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
-			);
+			, TRACE_PAGES, TIMER_FREQ);
 	power_off ();
 }
 
@@ -354,8 +458,14 @@ power_off (void) {
 /* Print statistics about Pintos execution. */
 static void
 print_stats (void) {
+	trace_dump ();
+	profile_dump ();
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	lockstat_print ();
+	malloc_print_stats ();
+	kmem_cache_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -107,6 +107,22 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */ // 외부 인터럽트를 처리하고 있나요?
 static bool yield_on_return;    /* Should we yield on interrupt return? */     // 인터럽트 리턴을 양보해야 할까요?
 
+/* Softirqs are the second half of external interrupt handling.
+   A handler that has more to do than it should with interrupts
+   off raises a softirq, and the softirq's function runs just
+   before the interrupt returns, after the PIC has been
+   acknowledged, with interrupts on.  Softirq functions may not
+   sleep either, and intr_context() is true while they run, but
+   other interrupts can come in.  They do not nest: an interrupt
+   that arrives during one leaves its softirqs to the loop in
+   softirq_run() that is already going. */
+#define SOFTIRQ_RESTART 4       /* Passes over pending softirqs. */
+static softirq_func *softirq_handlers[SOFTIRQ_CNT];
+static volatile unsigned softirq_pending;   /* Bit N: softirq N raised. */
+static bool in_softirq;         /* Are we running softirqs? */
+
+static void softirq_run (void);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -262,7 +278,7 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 // 외부 인터럽트를 처리하는 동안 true를 반환하고 다른 시간에는 false를 반환합니다.
 bool
 intr_context (void) {
-	return in_external_intr;
+	return in_external_intr || in_softirq;
 }
 
 /* During processing of an external interrupt, directs the
@@ -351,10 +367,12 @@ intr_handler (struct intr_frame *frame) {
 	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
-		ASSERT (!intr_context ());
+		ASSERT (!in_external_intr);
 
 		in_external_intr = true;
-		yield_on_return = false;
+
+		/* Catch up on ticks skipped by tickless idle. */
+		timer_irq_enter ();
 	}
 
 	/* Invoke the interrupt's handler. */
@@ -384,9 +402,68 @@ intr_handler (struct intr_frame *frame) {
 		in_external_intr = false;
 		pic_end_of_interrupt (frame->vec_no);
 
-		if (yield_on_return)
+		/* An interrupt that arrived while softirqs were running
+		   leaves the yield to the interrupt they belong to. */
+		softirq_run ();
+		if (yield_on_return && !in_softirq) {
+			yield_on_return = false;
 			thread_yield ();
+		}
+	}
+}
+
+/* Sets FUNC as the function for softirq NR and returns the
+   function it replaces, or a null pointer. */
+softirq_func *
+softirq_register (enum softirq nr, softirq_func *func) {
+	enum intr_level old_level;
+	softirq_func *old;
+
+	ASSERT (nr < SOFTIRQ_CNT);
+	old_level = intr_disable ();
+	old = softirq_handlers[nr];
+	softirq_handlers[nr] = func;
+	intr_set_level (old_level);
+	return old;
+}
+
+/* Arranges for softirq NR's function to run when the current
+   external interrupt returns or, if called outside an external
+   interrupt, when the next one does. */
+void
+softirq_raise (enum softirq nr) {
+	enum intr_level old_level = intr_disable ();
+
+	ASSERT (nr < SOFTIRQ_CNT);
+	softirq_pending |= 1u << nr;
+	intr_set_level (old_level);
+}
+
+/* Runs the functions of the raised softirqs with interrupts on,
+   passing over them again if interrupts raise more, up to
+   SOFTIRQ_RESTART times.  Any still left over wait for the next
+   interrupt.  Interrupts must be off. */
+static void
+softirq_run (void) {
+	int pass;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (in_softirq)
+		return;
+	in_softirq = true;
+	for (pass = 0; pass < SOFTIRQ_RESTART && softirq_pending != 0; pass++) {
+		unsigned pending = softirq_pending;
+		int nr;
+
+		softirq_pending = 0;
+		intr_enable ();
+		for (nr = 0; nr < SOFTIRQ_CNT; nr++)
+			if (pending & (1u << nr) && softirq_handlers[nr] != NULL)
+				softirq_handlers[nr] ();
+		intr_disable ();
 	}
+	in_softirq = false;
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
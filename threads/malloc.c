@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -24,9 +25,18 @@
    list.  Then we return one of the new blocks.
 
    When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   An arena that now has no in-use blocks is kept, in case the
+   blocks are wanted again soon, but once a descriptor has more
+   than a few such arenas, we remove their blocks from the free
+   list and give all but one of them back to the page allocator.
+
+   In front of the free list, each descriptor has a "magazine", a
+   small stack of free blocks.  malloc() takes a block from it and
+   free() puts one there with interrupts turned off rather than
+   with the descriptor's lock held, which is as good as a per-CPU
+   cache on our single CPU.  Only when the magazine is empty or
+   full does a call take the lock, and then it moves half a
+   magazine of blocks at once.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -34,12 +44,36 @@
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Most blocks a magazine holds. */
+#define MAG_SIZE 32
+
+/* Arenas with no blocks in use are kept for reuse until there are
+   more than EMPTY_ARENA_MAX of them, and then all but
+   EMPTY_ARENA_MIN are given back to the page allocator. */
+#define EMPTY_ARENA_MAX 4
+#define EMPTY_ARENA_MIN 1
+
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
+	struct list empty_arenas;   /* Arenas with no blocks in use. */
+	size_t empty_cnt;           /* Number of arenas in empty_arenas. */
 	struct lock lock;           /* Lock. */
+
+	/* Magazine: free blocks that malloc() and free() pass back
+	   and forth without taking the lock.  Interrupts must be off
+	   to use it. */
+	struct block *mag[MAG_SIZE];
+	size_t mag_cnt;             /* Blocks in mag[]. */
+	size_t mag_max;             /* Capacity of mag[]. */
+
+	/* Statistics. */
+	unsigned long long hits;    /* Calls served by the magazine. */
+	unsigned long long misses;  /* Calls that took the lock. */
+	unsigned long long arenas_created;
+	unsigned long long arenas_freed;
 };
 
 /* Magic number for detecting arena corruption. */
@@ -50,6 +84,7 @@ struct arena {
 	unsigned magic;             /* Always set to ARENA_MAGIC. */
 	struct desc *desc;          /* Owning descriptor, null for big block. */
 	size_t free_cnt;            /* Free blocks; pages in big block. */
+	struct list_elem empty_elem;    /* Element in desc's empty_arenas. */
 };
 
 /* Free block. */
@@ -61,8 +96,15 @@ struct block {
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Set by "-mallocstat". */
+bool mallocstat_enabled;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *get_free_block (struct desc *);
+static void put_free_block (struct desc *, struct block *);
+static bool add_arena (struct desc *);
+static void release_arena (struct desc *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -75,7 +117,14 @@ malloc_init (void) {
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
+		list_init (&d->empty_arenas);
+		d->empty_cnt = 0;
 		lock_init (&d->lock);
+		d->mag_cnt = 0;
+		d->mag_max = d->blocks_per_arena < MAG_SIZE
+			? d->blocks_per_arena : MAG_SIZE;
+		d->hits = d->misses = 0;
+		d->arenas_created = d->arenas_freed = 0;
 	}
 }
 
@@ -83,6 +132,7 @@ malloc_init (void) {
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) {
+	enum intr_level old_level;
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
@@ -112,33 +162,33 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
+	/* Take a block from the magazine if it has one. */
+	old_level = intr_disable ();
+	if (d->mag_cnt > 0) {
+		b = d->mag[--d->mag_cnt];
+		d->hits++;
+		intr_set_level (old_level);
+		return b;
+	}
+	intr_set_level (old_level);
+
 	lock_acquire (&d->lock);
+	d->misses++;
 
 	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
-
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
+	if (list_empty (&d->free_list) && !add_arena (d)) {
+		lock_release (&d->lock);
+		return NULL;
 	}
+	b = get_free_block (d);
+
+	/* Fill half the magazine from the blocks already free, so
+	   that the next few calls need not take the lock. */
+	old_level = intr_disable ();
+	while (d->mag_cnt < d->mag_max / 2 && !list_empty (&d->free_list))
+		d->mag[d->mag_cnt++] = get_free_block (d);
+	intr_set_level (old_level);
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
 	lock_release (&d->lock);
 	return b;
 }
@@ -178,18 +228,36 @@ block_size (void *block) {
    If successful, returns the new block; on failure, returns a
    null pointer.
    A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
-   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK).
+
+   OLD_BLOCK is returned unmoved if it already has room for
+   NEW_SIZE bytes or, for a big block, if the pages that follow
+   it are free and can be added to it. */
 void *
 realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
-	} else {
-		void *new_block = malloc (new_size);
-		if (old_block != NULL && new_block != NULL) {
-			size_t old_size = block_size (old_block);
-			size_t min_size = new_size < old_size ? new_size : old_size;
-			memcpy (new_block, old_block, min_size);
+	} else if (old_block == NULL)
+		return malloc (new_size);
+	else {
+		size_t old_size = block_size (old_block);
+		struct arena *a = block_to_arena (old_block);
+		void *new_block;
+
+		if (new_size <= old_size)
+			return old_block;
+		if (a->desc == NULL) {
+			size_t page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+			if (palloc_extend (a, a->free_cnt, page_cnt)) {
+				a->free_cnt = page_cnt;
+				return old_block;
+			}
+		}
+
+		new_block = malloc (new_size);
+		if (new_block != NULL) {
+			memcpy (new_block, old_block, old_size);
 			free (old_block);
 		}
 		return new_block;
@@ -201,6 +269,7 @@ realloc (void *old_block, size_t new_size) {
 void
 free (void *p) {
 	if (p != NULL) {
+		enum intr_level old_level;
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
 		struct desc *d = a->desc;
@@ -213,22 +282,32 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			/* Put the block in the magazine if there is room. */
+			old_level = intr_disable ();
+			if (d->mag_cnt < d->mag_max) {
+				d->mag[d->mag_cnt++] = b;
+				d->hits++;
+				intr_set_level (old_level);
+				return;
 			}
+			intr_set_level (old_level);
+
+			lock_acquire (&d->lock);
+			d->misses++;
+
+			/* Add block to free list, along with half the
+			   magazine. */
+			put_free_block (d, b);
+			old_level = intr_disable ();
+			while (d->mag_cnt > d->mag_max / 2)
+				put_free_block (d, d->mag[--d->mag_cnt]);
+			intr_set_level (old_level);
+
+			/* If too many arenas are entirely unused, free all but
+			   EMPTY_ARENA_MIN of them. */
+			if (d->empty_cnt > EMPTY_ARENA_MAX)
+				while (d->empty_cnt > EMPTY_ARENA_MIN)
+					release_arena (d);
 
 			lock_release (&d->lock);
 		} else {
@@ -266,3 +345,96 @@ arena_to_block (struct arena *a, size_t idx) {
 			+ sizeof *a
 			+ idx * a->desc->block_size);
 }
+
+/* Creates a new arena for D and adds its blocks to D's free list.
+   Returns false if memory is short.  D's lock must be held. */
+static bool
+add_arena (struct desc *d) {
+	struct arena *a = palloc_get_page (0);
+	size_t i;
+
+	if (a == NULL)
+		return false;
+
+	a->magic = ARENA_MAGIC;
+	a->desc = d;
+	a->free_cnt = d->blocks_per_arena;
+	for (i = 0; i < d->blocks_per_arena; i++) {
+		struct block *b = arena_to_block (a, i);
+		list_push_back (&d->free_list, &b->free_elem);
+	}
+	list_push_back (&d->empty_arenas, &a->empty_elem);
+	d->empty_cnt++;
+	d->arenas_created++;
+	return true;
+}
+
+/* Gives the oldest unused arena of D back to the page allocator.
+   D's lock must be held. */
+static void
+release_arena (struct desc *d) {
+	struct arena *a = list_entry (list_pop_front (&d->empty_arenas),
+			struct arena, empty_elem);
+	size_t i;
+
+	ASSERT (a->free_cnt == d->blocks_per_arena);
+	for (i = 0; i < d->blocks_per_arena; i++) {
+		struct block *b = arena_to_block (a, i);
+		list_remove (&b->free_elem);
+	}
+	d->empty_cnt--;
+	d->arenas_freed++;
+	palloc_free_page (a);
+}
+
+/* Removes and returns a block from D's free list, which must not
+   be empty.  D's lock must be held. */
+static struct block *
+get_free_block (struct desc *d) {
+	struct block *b = list_entry (list_pop_front (&d->free_list),
+			struct block, free_elem);
+	struct arena *a = block_to_arena (b);
+
+	if (a->free_cnt-- == d->blocks_per_arena) {
+		list_remove (&a->empty_elem);
+		d->empty_cnt--;
+	}
+	return b;
+}
+
+/* Adds block B to D's free list.  D's lock must be held. */
+static void
+put_free_block (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	list_push_front (&d->free_list, &b->free_elem);
+	if (++a->free_cnt == d->blocks_per_arena) {
+		list_push_back (&d->empty_arenas, &a->empty_elem);
+		d->empty_cnt++;
+	}
+}
+
+/* Prints statistics for each descriptor that was used, if
+   "-mallocstat" was given.  "Churn" is arenas created and
+   freed. */
+void
+malloc_print_stats (void) {
+	size_t i;
+
+	if (!mallocstat_enabled)
+		return;
+
+	printf ("Malloc statistics:\n");
+	printf ("%6s %12s %12s %6s %10s %10s %6s\n", "size", "mag hits",
+			"locked", "hit%", "arenas", "freed", "empty");
+	for (i = 0; i < desc_cnt; i++) {
+		struct desc *d = &descs[i];
+		unsigned long long calls = d->hits + d->misses;
+
+		if (calls == 0)
+			continue;
+		printf ("%6zu %12llu %12llu %5llu%% %10llu %10llu %6zu\n",
+				d->block_size, d->hits, d->misses, d->hits * 100 / calls,
+				d->arenas_created, d->arenas_freed, d->empty_cnt);
+	}
+}
@@ -2,14 +2,17 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +27,49 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages form
+   blocks of 2**ORDER pages, for ORDER from 0 to MAX_ORDER, each
+   aligned to its size relative to the pool's base and kept on the
+   free list for its order.  A block's buddy is the block of the
+   same order that it was split from, and a freed block is merged
+   with its buddy, if that is free, into a block of the next order
+   up, and so on.  An allocation of N pages takes a block of the
+   smallest order that holds N pages, splitting a larger block if
+   necessary, and gives the pages past N straight back, so that
+   allocating or freeing takes O(MAX_ORDER) steps rather than a
+   scan of the pool.  A request for more pages than a block of
+   MAX_ORDER holds is rare; it scans used_map for a long enough
+   run of free pages instead and takes them off the free lists
+   one at a time.
+
+   A free block keeps its list element in its first page.  The
+   pool's free_order array records, for each page that starts a
+   free block, the block's order, so that a buddy can be checked
+   for being free in constant time.  used_map still marks the
+   pages in use, for checking frees.
+
+   The free lists are protected by disabling interrupts, not by a
+   lock, because do_schedule() frees the pages of dead threads
+   with interrupts off.
+
+   Single kernel pages wanted with PAL_ZERO come, when possible,
+   from a small supply of pages zeroed in advance by the
+   low-priority pagezero thread, so that the zeroing happens when
+   the CPU would otherwise be idle rather than on the requester's
+   time.  When the kernel pool runs out, the supply is given back
+   to it. */
+
+#define MAX_ORDER PALLOC_MAX_ORDER      /* Largest block: 4 MB. */
+#define NOT_FREE 0xff                   /* free_order of other pages. */
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	uint8_t *free_order;            /* Order of free block starting at page. */
+	struct list free_lists[MAX_ORDER + 1];  /* Free blocks by order. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -38,10 +77,32 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* Set by "-pallocstat". */
+bool pallocstat_enabled;
+
+/* Kernel pages that the pagezero thread has already zeroed, for
+   single-page PAL_ZERO requests.  They are marked used in the
+   kernel pool and protected by its lock. */
+#define ZEROED_PAGES 64
+static void *zeroed_pages[ZEROED_PAGES];
+static size_t zeroed_cnt;
+static bool zeroing_started;
+static struct semaphore zeroing_wanted; /* Upped when supply is low. */
+static unsigned long long zeroed_hits;  /* Requests served pre-zeroed. */
+static unsigned long long zeroed_misses;        /* Requests zeroed on demand. */
+
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
+static void *get_block (struct pool *, size_t page_cnt);
+static void *get_run (struct pool *, size_t page_cnt);
+static thread_func zeroing_thread;
 
 static bool page_from_pool (const struct pool *, void *page);
+static void release_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void take_free_page (struct pool *, size_t page_idx);
+static struct list_elem *block_elem (struct pool *, size_t page_idx);
 
 /* multiboot info */
 struct multiboot_info {
@@ -223,12 +284,12 @@ split:
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				release_pages (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				release_pages (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,20 +323,44 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	bool want_zeroed = (flags & PAL_ZERO) && page_cnt == 1
+		&& pool == &kernel_pool;
+	bool zeroed = false;
+	enum intr_level old_level;
+	void *pages = NULL;
+
+	old_level = intr_disable ();
+	if (want_zeroed) {
+		if (zeroed_cnt > 0) {
+			pages = zeroed_pages[--zeroed_cnt];
+			zeroed = true;
+			zeroed_hits++;
+		} else
+			zeroed_misses++;
+	}
+	if (pages == NULL) {
+		pages = get_block (pool, page_cnt);
+		if (pages == NULL && pool == &kernel_pool && zeroed_cnt > 0) {
+			/* Memory is short.  Give back the pre-zeroed pages and
+			   try again. */
+			while (zeroed_cnt > 0)
+				release_pages (pool, pg_no (zeroed_pages[--zeroed_cnt])
+						- pg_no (pool->base), 1);
+			pages = get_block (pool, page_cnt);
+		}
+	}
+	intr_set_level (old_level);
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
-
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (want_zeroed && zeroing_started && zeroed_cnt < ZEROED_PAGES / 2)
+		sema_up (&zeroing_wanted);
 
 	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+		if ((flags & PAL_ZERO) && !zeroed) {
+			size_t i;
+
+			for (i = 0; i < page_cnt; i++)
+				clear_page ((uint8_t *) pages + PGSIZE * i);
+		}
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -296,11 +381,106 @@ palloc_get_page (enum palloc_flags flags) {
 	return palloc_get_multiple (flags, 1);
 }
 
+/* Fills PAGE, which must be page-aligned, with zeros. */
+void
+clear_page (void *page) {
+	size_t word_cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (page) == 0);
+
+	__asm __volatile ("rep stosq"
+			: "+D" (page), "+c" (word_cnt)
+			: "a" (0)
+			: "memory");
+}
+
+/* Copies page SRC to page DST.  Both must be page-aligned. */
+void
+copy_page (void *dst, const void *src) {
+	size_t word_cnt = PGSIZE / sizeof (uint64_t);
+
+	ASSERT (pg_ofs (dst) == 0);
+	ASSERT (pg_ofs (src) == 0);
+
+	__asm __volatile ("rep movsq"
+			: "+D" (dst), "+S" (src), "+c" (word_cnt)
+			:
+			: "memory");
+}
+
+/* Starts the thread that keeps a supply of zeroed kernel pages.
+   The scheduler must be running. */
+void
+palloc_start_zeroing (void) {
+	sema_init (&zeroing_wanted, 1);
+	if (thread_create ("pagezero", PRI_MIN, zeroing_thread, NULL)
+			== TID_ERROR)
+		PANIC ("cannot create pagezero thread");
+	zeroing_started = true;
+}
+
+/* Prints how many single-page PAL_ZERO requests from the kernel
+   pool were served with a page that was zeroed ahead of time, if
+   "-pallocstat" was given. */
+void
+palloc_print_stats (void) {
+	unsigned long long total = zeroed_hits + zeroed_misses;
+
+	if (!pallocstat_enabled)
+		return;
+	printf ("Palloc: %llu of %llu zeroed page requests served pre-zeroed"
+			" (%llu%%)\n", zeroed_hits, total,
+			total > 0 ? zeroed_hits * 100 / total : 0);
+}
+
+/* Tries to grow the block of PAGE_CNT pages at PAGES, obtained
+   from palloc_get_multiple(), to NEW_CNT pages in place, by
+   allocating the pages that follow it.  Returns true if
+   successful, false if any of those pages is in use or past the
+   end of the pool.  The new pages are not zeroed. */
+bool
+palloc_extend (void *pages, size_t page_cnt, size_t new_cnt) {
+	struct pool *pool;
+	size_t page_idx, i;
+	enum intr_level old_level;
+	bool success = false;
+
+	ASSERT (pg_ofs (pages) == 0);
+	ASSERT (page_cnt > 0);
+	if (new_cnt <= page_cnt)
+		return true;
+
+	if (page_from_pool (&kernel_pool, pages))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, pages))
+		pool = &user_pool;
+	else
+		NOT_REACHED ();
+
+	page_idx = pg_no (pages) - pg_no (pool->base);
+
+	old_level = intr_disable ();
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	if (page_idx + new_cnt <= bitmap_size (pool->used_map)
+			&& bitmap_none (pool->used_map, page_idx + page_cnt,
+				new_cnt - page_cnt)) {
+		for (i = page_idx + page_cnt; i < page_idx + new_cnt; i++)
+			take_free_page (pool, i);
+		bitmap_set_multiple (pool->used_map, page_idx + page_cnt,
+				new_cnt - page_cnt, true);
+		success = true;
+	}
+	intr_set_level (old_level);
+
+	return success;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
 	size_t page_idx;
+	enum intr_level old_level;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -318,8 +498,10 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	release_pages (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,23 +510,195 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Takes a block of PAGE_CNT pages off POOL's free lists, marks
+   it used and returns it, or returns a null pointer if there is
+   no such block.  POOL's lock must be held. */
+static void *
+get_block (struct pool *pool, size_t page_cnt) {
+	int order = 0, o;
+	uint8_t *block;
+	size_t page_idx;
+
+	if (page_cnt > (size_t) 1 << MAX_ORDER)
+		return get_run (pool, page_cnt);
+	while (((size_t) 1 << order) < page_cnt)
+		order++;
+
+	for (o = order; o <= MAX_ORDER; o++)
+		if (!list_empty (&pool->free_lists[o]))
+			break;
+	if (page_cnt == 0 || o > MAX_ORDER)
+		return NULL;
+
+	block = (uint8_t *) list_pop_front (&pool->free_lists[o]);
+	page_idx = pg_no (block) - pg_no (pool->base);
+
+	/* Split the block down to ORDER, freeing the upper halves,
+	   then give back the pages past PAGE_CNT. */
+	pool->free_order[page_idx] = NOT_FREE;
+	while (o > order) {
+		o--;
+		free_block (pool, page_idx + ((size_t) 1 << o), o);
+	}
+	release_pages (pool, page_idx + page_cnt,
+			((size_t) 1 << order) - page_cnt);
+
+	ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	return block;
+}
+
+/* Takes a run of PAGE_CNT free pages, more than a block holds,
+   off POOL's free lists, marks it used and returns it, or returns
+   a null pointer if POOL has no such run.  POOL's lock must be
+   held. */
+static void *
+get_run (struct pool *pool, size_t page_cnt) {
+	size_t page_idx = bitmap_scan (pool->used_map, 0, page_cnt, false);
+	size_t i;
+
+	if (page_idx == BITMAP_ERROR)
+		return NULL;
+	for (i = 0; i < page_cnt; i++)
+		take_free_page (pool, page_idx + i);
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	return pool->base + PGSIZE * page_idx;
+}
+
+/* The pagezero thread.  Whenever the supply of zeroed pages runs
+   low, takes pages from the kernel pool, zeroes them and adds
+   them to the supply, until it is full.  It runs at the lowest
+   priority, so that the zeroing happens when there is nothing
+   else to do. */
+static void
+zeroing_thread (void *aux UNUSED) {
+	if (thread_mlfqs)
+		thread_set_nice (NICE_MAX);
+	for (;;) {
+		sema_down (&zeroing_wanted);
+		for (;;) {
+			enum intr_level old_level;
+			void *page = NULL;
+
+			old_level = intr_disable ();
+			if (zeroed_cnt < ZEROED_PAGES)
+				page = get_block (&kernel_pool, 1);
+			intr_set_level (old_level);
+			if (page == NULL)
+				break;
+
+			clear_page (page);
+
+			old_level = intr_disable ();
+			if (zeroed_cnt < ZEROED_PAGES) {
+				zeroed_pages[zeroed_cnt++] = page;
+				page = NULL;
+			}
+			intr_set_level (old_level);
+			if (page != NULL) {
+				palloc_free_page (page);
+				break;
+			}
+		}
+	}
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
+  /* We'll put the pool's used_map and free_order at BM_BASE.
      Calculate the space needed for the bitmap
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t fo_pages = DIV_ROUND_UP (pgcnt, PGSIZE) * PGSIZE;
+	int order;
 
-	lock_init(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->free_order = (uint8_t *) *bm_base + bm_pages;
+	for (order = 0; order <= MAX_ORDER; order++)
+		list_init (&p->free_lists[order]);
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->free_order, NOT_FREE, pgcnt);
+
+	*bm_base += bm_pages + fo_pages;
+}
+
+/* Marks the PAGE_CNT pages starting at PAGE_IDX in POOL free and
+   puts them on the free lists, as the largest aligned blocks that
+   they can be divided into. */
+static void
+release_pages (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < MAX_ORDER
+				&& page_idx % ((size_t) 2 << order) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Puts the free block of 2**ORDER pages starting at PAGE_IDX in
+   POOL on the free lists, first merging it with its buddy for as
+   long as the buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) {
+	size_t pool_pages = bitmap_size (pool->used_map);
+
+	while (order < MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy + ((size_t) 1 << order) > pool_pages
+				|| pool->free_order[buddy] != order)
+			break;
+		list_remove (block_elem (pool, buddy));
+		pool->free_order[buddy] = NOT_FREE;
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	pool->free_order[page_idx] = order;
+	list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
+}
+
+/* Takes free page PAGE_IDX in POOL off the free lists, by taking
+   off the free block that holds it and putting back the pages on
+   either side.  The caller marks the page used. */
+static void
+take_free_page (struct pool *pool, size_t page_idx) {
+	size_t start = page_idx;
+	int order = 0;
+
+	/* Blocks are aligned to their size, so the block that holds
+	   PAGE_IDX starts at PAGE_IDX rounded down to its size. */
+	while (pool->free_order[start] != order) {
+		order++;
+		ASSERT (order <= MAX_ORDER);
+		start = page_idx & ~(((size_t) 1 << order) - 1);
+	}
+	list_remove (block_elem (pool, start));
+	pool->free_order[start] = NOT_FREE;
+
+	/* PAGE_IDX itself stays off the free lists, since its free_order
+	   is NOT_FREE and its buddies cannot merge with it. */
+	release_pages (pool, start, page_idx - start);
+	release_pages (pool, page_idx + 1,
+			start + ((size_t) 1 << order) - page_idx - 1);
+}
 
-	*bm_base += bm_pages;
+/* Returns the list element of the free block starting at
+   PAGE_IDX in POOL, which is kept in the block itself. */
+static struct list_elem *
+block_elem (struct pool *pool, size_t page_idx) {
+	return (struct list_elem *) (pool->base + PGSIZE * page_idx);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,148 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/vaddr.h"
+
+/* Sampling profiler.
+
+   Each timer interrupt that arrives at or after the next sample
+   time records the interrupted rip and the return addresses
+   found by following the chain of saved frame pointers (the
+   kernel is built with -fno-omit-frame-pointer) into a ring
+   buffer.  Ticks alone give TIMER_FREQ samples a second; for a
+   faster rate a periodic hrtimer makes the timer interrupt come
+   more often.
+
+   profile_dump() prints the samples at power off as lines of the
+   form "PROF: rip ret ret ...", innermost frame first, which
+   "backtrace --folded" turns into input for flamegraph.pl. */
+
+#define PROFILE_SAMPLES 2048            /* Samples kept. */
+#define PROFILE_DEPTH 8                 /* PCs per sample. */
+#define PROFILE_MAX_HZ 10000            /* Fastest sampling rate. */
+
+/* One sample. */
+struct profile_sample {
+	uint8_t depth;                      /* Number of PCs. */
+	uint64_t pcs[PROFILE_DEPTH];        /* Innermost first. */
+};
+
+/* Sampling rate in samples per second, or 0 if the profiler is
+   off.  Set by kernel command-line option "-profile". */
+int profile_hz;
+
+static struct profile_sample samples[PROFILE_SAMPLES];
+static uint64_t sample_cnt;     /* Samples taken; the latest are kept. */
+static uint64_t user_cnt;       /* Samples that hit user code. */
+static int64_t period_ns;       /* Time between samples. */
+static int64_t next_ns;         /* When to take the next sample. */
+static bool sampling;           /* Taking samples? */
+static struct hrtimer sample_timer;
+
+static void sample_timer_func (struct hrtimer *);
+
+/* Starts sampling at profile_hz samples a second.  The timer must
+   be calibrated. */
+void
+profile_start (void) {
+	enum intr_level old_level;
+
+	if (profile_hz <= 0)
+		return;
+	if (profile_hz > PROFILE_MAX_HZ)
+		profile_hz = PROFILE_MAX_HZ;
+	period_ns = 1000000000 / profile_hz;
+
+	old_level = intr_disable ();
+	next_ns = timer_ns () + period_ns;
+	sampling = true;
+	if (profile_hz > TIMER_FREQ) {
+		hrtimer_init (&sample_timer, sample_timer_func);
+		hrtimer_start (&sample_timer, next_ns);
+	}
+	intr_set_level (old_level);
+}
+
+/* Records a sample of the code that interrupt frame F
+   interrupted, if one is due.  Called from the timer
+   interrupt. */
+void
+profile_sample (const struct intr_frame *f) {
+	struct profile_sample *s;
+	uintptr_t stack, fp;
+	int64_t now;
+
+	if (!sampling)
+		return;
+	now = timer_ns ();
+	if (now < next_ns)
+		return;
+	next_ns += period_ns;
+	if (next_ns <= now)
+		next_ns = now + period_ns;
+
+	if ((f->cs & 3) != 0) {
+		/* User code is in an address space addr2line knows nothing
+		   about, so just count it. */
+		user_cnt++;
+		return;
+	}
+
+	s = &samples[sample_cnt++ % PROFILE_SAMPLES];
+	s->pcs[0] = f->rip;
+	s->depth = 1;
+
+	/* Follow the frame pointers, but only as far as they stay
+	   inside the interrupted thread's kernel stack and move
+	   outward, so that a frame pointer caught mid-prologue or used
+	   as a general register cannot lead us astray. */
+	stack = (uintptr_t) pg_round_down (f->rsp);
+	for (fp = f->R.rbp; s->depth < PROFILE_DEPTH; ) {
+		uintptr_t *frame = (uintptr_t *) fp;
+
+		if (fp < stack || fp > stack + PGSIZE - 2 * sizeof (uintptr_t)
+				|| fp % sizeof (uintptr_t) != 0 || frame[1] == 0)
+			break;
+		s->pcs[s->depth++] = frame[1];
+		if (frame[0] <= fp)
+			break;
+		fp = frame[0];
+	}
+}
+
+/* Stops sampling and prints the samples taken, oldest first. */
+void
+profile_dump (void) {
+	uint64_t first, i;
+
+	if (profile_hz <= 0)
+		return;
+
+	sampling = false;
+	if (profile_hz > TIMER_FREQ)
+		hrtimer_cancel (&sample_timer);
+
+	first = sample_cnt > PROFILE_SAMPLES ? sample_cnt - PROFILE_SAMPLES : 0;
+	printf ("Profile: %"PRIu64" kernel samples (%"PRIu64" kept), "
+			"%"PRIu64" user samples, %d Hz\n",
+			sample_cnt, sample_cnt - first, user_cnt, profile_hz);
+	for (i = first; i < sample_cnt; i++) {
+		struct profile_sample *s = &samples[i % PROFILE_SAMPLES];
+		int j;
+
+		printf ("PROF:");
+		for (j = 0; j < s->depth; j++)
+			printf (" %#"PRIx64, s->pcs[j]);
+		printf ("\n");
+	}
+}
+
+/* Re-arms itself every period so that the timer interrupt comes
+   often enough to sample at profile_hz. */
+static void
+sample_timer_func (struct hrtimer *timer) {
+	hrtimer_start (timer, next_ns);
+}
@@ -0,0 +1,249 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab is a single page.  It begins with a struct slab, which
+   is followed by one free-list link for each object and then by
+   the objects themselves:
+
+      +-------------+---------------+-----+-----+-----+-------+
+      | struct slab | next[0..n-1]  | obj | obj | ... | waste |
+      +-------------+---------------+-----+-----+-----+-------+
+
+   Free objects are chained through next[] by index rather than
+   through the objects, so that freeing an object leaves its
+   constructed contents alone. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab5a1b
+
+/* Alignment of objects. */
+#define SLAB_ALIGN 8
+
+/* End of a slab's free list. */
+#define SLAB_END UINT16_MAX
+
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	size_t in_use;              /* Allocated objects. */
+	uint16_t free;              /* First free object, or SLAB_END. */
+	struct list_elem elem;      /* Element in cache's partial or full. */
+	uint16_t next[];            /* Next free object after each object. */
+};
+
+/* Set by "-slabstat". */
+bool slabstat_enabled;
+
+/* All the caches, for kmem_cache_print_stats(). */
+static struct list caches;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void *slab_obj (struct kmem_cache *, struct slab *, size_t idx);
+
+/* Creates and returns a cache of objects of SIZE bytes, each of
+   which CTOR, if nonnull, constructs when its slab is created.
+   NAME is not copied.  Panics if memory is short or if SIZE is
+   too big for a page. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor *ctor) {
+	struct kmem_cache *c;
+	size_t n;
+
+	ASSERT (name != NULL);
+	ASSERT (size > 0);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		PANIC ("%s: cannot allocate kmem_cache", name);
+	c->name = name;
+	c->obj_size = ROUND_UP (size, SLAB_ALIGN);
+	c->ctor = ctor;
+
+	/* Fit as many objects as possible, with a link apiece. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+				SLAB_ALIGN) + n * c->obj_size > PGSIZE)
+		n--;
+	if (n == 0)
+		PANIC ("%s: %zu-byte objects do not fit in a slab", name, size);
+	c->objs_per_slab = n;
+	c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+			SLAB_ALIGN);
+
+	list_init (&c->partial);
+	list_init (&c->full);
+	c->spare = NULL;
+	c->slab_cnt = c->in_use = c->in_use_max = 0;
+	c->alloc_cnt = c->free_cnt = c->slab_alloc_cnt = c->fail_cnt = 0;
+
+	/* The first cache initializes the list. */
+	if (caches.head.next == NULL)
+		list_init (&caches);
+	list_push_back (&caches, &c->elem);
+	return c;
+}
+
+/* Allocates and returns an object from cache C, or returns a
+   null pointer if memory is short. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	enum intr_level old_level;
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	old_level = intr_disable ();
+	c->alloc_cnt++;
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (c->spare != NULL) {
+		s = c->spare;
+		c->spare = NULL;
+		list_push_front (&c->partial, &s->elem);
+	} else {
+		/* Construct the new slab with interrupts on. */
+		intr_set_level (old_level);
+		s = slab_create (c);
+		intr_disable ();
+		if (s == NULL) {
+			c->fail_cnt++;
+			intr_set_level (old_level);
+			return NULL;
+		}
+		c->slab_cnt++;
+		c->slab_alloc_cnt++;
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	/* Take the slab's first free object. */
+	obj = slab_obj (c, s, s->free);
+	s->free = s->next[s->free];
+	if (++s->in_use == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_back (&c->full, &s->elem);
+	}
+	if (++c->in_use > c->in_use_max)
+		c->in_use_max = c->in_use;
+	intr_set_level (old_level);
+
+	return obj;
+}
+
+/* Returns OBJ, which must have come from cache C, to C.  Keeps
+   one slab without objects in use as C's spare and gives any
+   other back to the page allocator.  If OBJ is a null pointer,
+   does nothing. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	enum intr_level old_level;
+	struct slab *s;
+	size_t idx;
+
+	ASSERT (c != NULL);
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (c, obj);
+	idx = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs) / c->obj_size;
+	ASSERT (slab_obj (c, s, idx) == obj);
+
+	old_level = intr_disable ();
+	ASSERT (s->in_use > 0);
+	c->free_cnt++;
+	c->in_use--;
+	if (s->in_use-- == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	s->next[idx] = s->free;
+	s->free = idx;
+
+	if (s->in_use == 0) {
+		list_remove (&s->elem);
+		if (c->spare == NULL)
+			c->spare = s;
+		else {
+			c->slab_cnt--;
+			s->magic = 0;
+			palloc_free_page (s);
+		}
+	}
+	intr_set_level (old_level);
+}
+
+/* Prints statistics for each cache, if "-slabstat" was given.
+   "Used" is the fraction of the cache's slab memory that holds
+   allocated objects. */
+void
+kmem_cache_print_stats (void) {
+	struct list_elem *e;
+
+	if (!slabstat_enabled || caches.head.next == NULL)
+		return;
+
+	printf ("Slab statistics:\n");
+	printf ("%-16s %6s %5s %6s %8s %8s %12s %12s %6s %5s\n", "cache", "size",
+			"/slab", "slabs", "in use", "max", "allocs", "frees", "pages",
+			"used");
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+		size_t used = c->slab_cnt > 0
+			? c->in_use * c->obj_size * 100 / (c->slab_cnt * PGSIZE) : 0;
+
+		printf ("%-16s %6zu %5zu %6zu %8zu %8zu %12llu %12llu %6llu %4zu%%\n",
+				c->name, c->obj_size, c->objs_per_slab, c->slab_cnt,
+				c->in_use, c->in_use_max, c->alloc_cnt, c->free_cnt,
+				c->slab_alloc_cnt, used);
+		if (c->fail_cnt > 0)
+			printf ("%-16s %llu allocations failed.\n", "", c->fail_cnt);
+	}
+}
+
+/* Allocates a slab for cache C and constructs its objects.
+   Returns a null pointer if memory is short. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	size_t i;
+
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->in_use = 0;
+	s->free = 0;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : SLAB_END;
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (c, s, i));
+	}
+	return s;
+}
+
+/* Returns the slab that OBJ, an object of cache C, is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT ((uint8_t *) obj >= (uint8_t *) s + c->obj_ofs);
+	return s;
+}
+
+/* Returns object IDX in slab S of cache C. */
+static void *
+slab_obj (struct kmem_cache *c, struct slab *s, size_t idx) {
+	ASSERT (idx < c->objs_per_slab);
+	return (uint8_t *) s + c->obj_ofs + idx * c->obj_size;
+}
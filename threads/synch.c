@@ -28,9 +28,12 @@
 
 #include "threads/synch.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "intrinsic.h"
 
 /* One semaphore in a list. */
 struct semaphore_elem {
@@ -38,6 +41,38 @@ struct semaphore_elem {
 	struct semaphore semaphore;         /* This semaphore. */
 };
 
+/* Lock contention statistics for the locks, rwlocks or
+   semaphores initialized at one call site. */
+struct lock_class {
+	const void *site;                   /* Caller of the init function. */
+	const char *kind;                   /* "lock", "rwlock" or "sema". */
+	uint64_t acquired;                  /* Acquisitions. */
+	uint64_t contended;                 /* Acquisitions that waited. */
+	uint64_t wait_total, wait_max;      /* Cycles spent waiting. */
+	uint64_t hold_total, hold_max;      /* Cycles held. */
+};
+
+#define LOCKSTAT_CLASSES 256            /* Size of lock_classes. */
+#define LOCKSTAT_REPORT 32              /* Classes lockstat_print() shows. */
+
+/* Collect lock contention statistics?  Controlled by kernel
+   command-line option "-lockstat". */
+bool lockstat_enabled;
+
+/* Hash table of classes, keyed on call site, with linear
+   probing. */
+static struct lock_class lock_classes[LOCKSTAT_CLASSES];
+static size_t lock_class_cnt;
+static size_t lock_class_overflow;      /* Inits that found no room. */
+
+static void sema_setup (struct semaphore *, unsigned value,
+		struct lock_class *);
+static struct lock_class *lockstat_class (const void *site, const char *kind);
+static void lockstat_acquired (struct lock_class *, bool contended,
+		uint64_t wait);
+static void lockstat_released (struct lock_class *, uint64_t acquired_at);
+static int lockstat_compare (const void *, const void *);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -49,10 +84,20 @@ struct semaphore_elem {
    thread, if any). */
 void
 sema_init (struct semaphore *sema, unsigned value) {
+	sema_setup (sema, value,
+			lockstat_class (__builtin_return_address (0), "sema"));
+}
+
+/* Initializes SEMA to VALUE, counting its statistics in
+   CLASS. */
+static void
+sema_setup (struct semaphore *sema, unsigned value,
+		struct lock_class *class) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
 	list_init (&sema->waiters);
+	sema->class = class;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -66,17 +111,25 @@ sema_init (struct semaphore *sema, unsigned value) {
 void
 sema_down (struct semaphore *sema) {
 	enum intr_level old_level;
+	bool contended;
+	uint64_t start = 0;
 
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
+	contended = sema->value == 0;
+	if (contended && sema->class != NULL)
+		start = rdtsc ();
 	while (sema->value == 0) {
 		//insert in priority when inserting into waiters list
 		list_insert_ordered (&sema->waiters, &thread_current ()->elem, compare_priority, NULL);
 		thread_block ();
 	}
 	sema->value--;
+	if (sema->class != NULL)
+		lockstat_acquired (sema->class, contended,
+				contended ? rdtsc () - start : 0);
 	intr_set_level (old_level);
 }
 
@@ -97,6 +150,8 @@ sema_try_down (struct semaphore *sema) {
 	{
 		sema->value--;
 		success = true;
+		if (sema->class != NULL)
+			lockstat_acquired (sema->class, false, 0);
 	}
 	else
 		success = false;
@@ -204,7 +259,10 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
-	sema_init (&lock->semaphore, 1);
+	sema_setup (&lock->semaphore, 1,
+			lockstat_class (__builtin_return_address (0), "lock"));
+	heap_init (&lock->waiters, compare_donate_priority, NULL);
+	lock->hold.priority = PRI_MIN - 1;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -222,17 +280,35 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	bool contended;
+	uint64_t start = 0;
+
+	old_level = intr_disable ();
 
-	if (lock->holder) {
-		curr->wait_on_lock = lock;
-		list_insert_ordered(&lock->holder->donations, &curr->d_elem, 
-			compare_donate_priority, 0);
-    	donate_priority(); 
+	/* The multi-level feedback queue scheduler does not donate. */
+	contended = lock->holder != NULL;
+	if (contended) {
+		TRACE (LOCK_WAIT_ENTER, lock, lock->holder->tid);
+		start = rdtsc ();
+		if (!thread_mlfqs) {
+			curr->wait_on_lock = lock;
+			donate_priority ();
+		}
 	}
 
 	sema_down (&lock->semaphore);
-	curr->wait_on_lock = NULL;
-	lock->holder = thread_current ();
+	if (contended) {
+		thread_account_lock_wait (rdtsc () - start);
+		TRACE (LOCK_WAIT_EXIT, lock);
+	}
+	if (lock->semaphore.class != NULL)
+		lock->acquired_at = rdtsc ();
+	lock->holder = curr;
+	if (!thread_mlfqs)
+		insert_with_lock (lock);
+
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -243,14 +319,22 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
+		if (lock->semaphore.class != NULL)
+			lock->acquired_at = rdtsc ();
 		lock->holder = thread_current ();
+		if (!thread_mlfqs)
+			insert_with_lock (lock);
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -262,16 +346,23 @@ lock_try_acquire (struct lock *lock) {
    handler. */
 void
 lock_release (struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	// Update the waiting list of the current thread after breaking the lock
-	remove_with_lock(lock);
-	// Initialize to original priority because priority may have been donated
-  	refresh_priority();
+	old_level = intr_disable ();
+	if (!thread_mlfqs) {
+		// Stop receiving the donations of LOCK's waiters
+		remove_with_lock(lock);
+		// Initialize to original priority because priority may have been donated
+		refresh_priority();
+	}
 
+	lockstat_released (lock->semaphore.class, lock->acquired_at);
 	lock->holder = NULL;
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -285,6 +376,268 @@ lock_held_by_current_thread (const struct lock *lock) {
 }
 
 
+static struct thread *rwlock_top_waiter (struct heap *);
+static struct rwlock_reader *rwlock_find_reader (const struct rwlock *,
+		struct thread *);
+static bool rwlock_has_readers (struct rwlock *);
+static void rwlock_grant_read (struct rwlock *, struct thread *);
+static void rwlock_grant_write (struct rwlock *, struct thread *);
+static void rwlock_wait (struct rwlock *, bool write);
+static void rwlock_wake (struct rwlock *);
+
+/* Initializes RWLOCK as released.  An rwlock can be held either
+   by any number of readers or by a single writer.  Like locks,
+   rwlocks are not recursive: a thread holding RWLOCK in either
+   mode must not try to acquire it again. */
+void
+rwlock_init (struct rwlock *rwlock) {
+	ASSERT (rwlock != NULL);
+
+	rwlock->writer = NULL;
+	list_init (&rwlock->readers);
+	rwlock->untracked = 0;
+	heap_init (&rwlock->read_waiters, compare_donate_priority, NULL);
+	heap_init (&rwlock->write_waiters, compare_donate_priority, NULL);
+	rwlock->priority = PRI_MIN - 1;
+	rwlock->hold.priority = PRI_MIN - 1;
+	rwlock->class = lockstat_class (__builtin_return_address (0), "rwlock");
+}
+
+/* Acquires RWLOCK for reading, sleeping until no writer holds it
+   and no writer of at least our priority is waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rwlock) {
+	struct thread *curr = thread_current ();
+	struct thread *writer;
+	enum intr_level old_level;
+
+	ASSERT (rwlock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rwlock));
+
+	old_level = intr_disable ();
+	writer = rwlock_top_waiter (&rwlock->write_waiters);
+	if (rwlock->writer == NULL
+			&& (writer == NULL || writer->priority < curr->priority)) {
+		rwlock_grant_read (rwlock, curr);
+		lockstat_acquired (rwlock->class, false, 0);
+	} else
+		rwlock_wait (rwlock, false);
+	intr_set_level (old_level);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rwlock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rwlock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_by_current_thread (rwlock));
+
+	old_level = intr_disable ();
+	if (rwlock->writer == NULL && !rwlock_has_readers (rwlock)) {
+		rwlock_grant_write (rwlock, curr);
+		lockstat_acquired (rwlock->class, false, 0);
+	} else
+		rwlock_wait (rwlock, true);
+	intr_set_level (old_level);
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   reading. */
+void
+rwlock_release_read (struct rwlock *rwlock) {
+	struct thread *curr = thread_current ();
+	struct rwlock_reader *r;
+	enum intr_level old_level;
+
+	ASSERT (rwlock != NULL);
+
+	old_level = intr_disable ();
+	r = rwlock_find_reader (rwlock, curr);
+	if (r != NULL) {
+		lockstat_released (rwlock->class, r->acquired_at);
+		list_remove (&r->elem);
+		r->rwlock = NULL;
+		if (!thread_mlfqs)
+			remove_with_hold (curr, &r->hold);
+	} else {
+		ASSERT (rwlock->untracked > 0);
+		rwlock->untracked--;
+	}
+	if (!rwlock_has_readers (rwlock))
+		rwlock_wake (rwlock);
+	test_max_priority ();
+	intr_set_level (old_level);
+}
+
+/* Releases RWLOCK, which the current thread must hold for
+   writing. */
+void
+rwlock_release_write (struct rwlock *rwlock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rwlock != NULL);
+	ASSERT (rwlock->writer == curr);
+
+	old_level = intr_disable ();
+	lockstat_released (rwlock->class, rwlock->acquired_at);
+	rwlock->writer = NULL;
+	if (!thread_mlfqs)
+		remove_with_hold (curr, &rwlock->hold);
+	rwlock_wake (rwlock);
+	test_max_priority ();
+	intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RWLOCK for reading or
+   writing, false otherwise.  A reader that had no read hold free
+   when it acquired RWLOCK is not recognized. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rwlock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	bool held;
+
+	ASSERT (rwlock != NULL);
+
+	old_level = intr_disable ();
+	held = rwlock->writer == curr || rwlock_find_reader (rwlock, curr) != NULL;
+	intr_set_level (old_level);
+	return held;
+}
+
+/* Returns the highest-priority thread in WAITERS, or a null
+   pointer if WAITERS is empty. */
+static struct thread *
+rwlock_top_waiter (struct heap *waiters) {
+	return heap_empty (waiters) ? NULL
+		: heap_entry (heap_top (waiters), struct thread, d_elem);
+}
+
+/* Returns T's read hold on RWLOCK, or a null pointer if T does
+   not hold RWLOCK for reading. */
+static struct rwlock_reader *
+rwlock_find_reader (const struct rwlock *rwlock, struct thread *t) {
+	int i;
+
+	for (i = 0; i < THREAD_READ_HOLDS; i++)
+		if (t->read_holds[i].rwlock == rwlock)
+			return &t->read_holds[i];
+	return NULL;
+}
+
+/* Returns true if any thread holds RWLOCK for reading.
+   Interrupts must be off. */
+static bool
+rwlock_has_readers (struct rwlock *rwlock) {
+	return !list_empty (&rwlock->readers) || rwlock->untracked > 0;
+}
+
+/* Makes T a reader holding RWLOCK, using one of T's free read
+   holds.  If T has none free, T is only counted as a reader, and
+   waiters do not donate to it through RWLOCK.  Interrupts must
+   be off. */
+static void
+rwlock_grant_read (struct rwlock *rwlock, struct thread *t) {
+	struct rwlock_reader *r = rwlock_find_reader (NULL, t);
+
+	if (r == NULL) {
+		rwlock->untracked++;
+		return;
+	}
+	r->rwlock = rwlock;
+	r->thread = t;
+	list_push_back (&rwlock->readers, &r->elem);
+	if (rwlock->class != NULL)
+		r->acquired_at = rdtsc ();
+	if (!thread_mlfqs)
+		insert_with_hold (t, &r->hold, rwlock->priority);
+}
+
+/* Makes T the writer holding RWLOCK.  Interrupts must be off. */
+static void
+rwlock_grant_write (struct rwlock *rwlock, struct thread *t) {
+	rwlock->writer = t;
+	if (rwlock->class != NULL)
+		rwlock->acquired_at = rdtsc ();
+	if (!thread_mlfqs)
+		insert_with_hold (t, &rwlock->hold, rwlock->priority);
+}
+
+/* Waits, as a reader or as a writer according to WRITE, until
+   rwlock_wake() grants RWLOCK to the current thread, donating
+   our priority to its holders in the meantime.  Interrupts must
+   be off. */
+static void
+rwlock_wait (struct rwlock *rwlock, bool write) {
+	struct thread *curr = thread_current ();
+	uint64_t start = rdtsc (), wait;
+
+	curr->wait_on_rwlock = rwlock;
+	curr->wait_to_write = write;
+	heap_push (write ? &rwlock->write_waiters : &rwlock->read_waiters,
+			&curr->d_elem);
+	rwlock_update_priority (rwlock);
+
+	while (curr->wait_on_rwlock != NULL)
+		thread_block ();
+	wait = rdtsc () - start;
+	thread_account_lock_wait (wait);
+	lockstat_acquired (rwlock->class, true, wait);
+}
+
+/* Grants RWLOCK, which no thread holds any longer, to the waiters
+   that should have it next: the highest-priority writer, if it
+   has at least the priority of every waiting reader, otherwise
+   every reader whose priority is higher than that of any waiting
+   writer.  Interrupts must be off. */
+static void
+rwlock_wake (struct rwlock *rwlock) {
+	struct thread *writer = rwlock_top_waiter (&rwlock->write_waiters);
+	struct thread *reader = rwlock_top_waiter (&rwlock->read_waiters);
+	struct list granted;
+
+	ASSERT (rwlock->writer == NULL && !rwlock_has_readers (rwlock));
+
+	list_init (&granted);
+	if (writer != NULL && (reader == NULL || writer->priority >= reader->priority)) {
+		heap_pop (&rwlock->write_waiters);
+		list_push_back (&granted, &writer->elem);
+	} else
+		while (reader != NULL
+				&& (writer == NULL || reader->priority > writer->priority)) {
+			heap_pop (&rwlock->read_waiters);
+			list_push_back (&granted, &reader->elem);
+			reader = rwlock_top_waiter (&rwlock->read_waiters);
+		}
+
+	/* The new holders receive the donations of the waiters that
+	   are left. */
+	rwlock_update_priority (rwlock);
+	while (!list_empty (&granted)) {
+		struct thread *t = list_entry (list_pop_front (&granted),
+				struct thread, elem);
+
+		t->wait_on_rwlock = NULL;
+		if (t->wait_to_write)
+			rwlock_grant_write (rwlock, t);
+		else
+			rwlock_grant_read (rwlock, t);
+		thread_unblock (t);
+	}
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -365,3 +718,116 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	while (!list_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
+
+/* Returns the class of the locks of the given KIND initialized at
+   SITE, creating it if necessary, or a null pointer if lockstat
+   is off or the class table is full. */
+static struct lock_class *
+lockstat_class (const void *site, const char *kind) {
+	struct lock_class *class = NULL;
+	enum intr_level old_level;
+	size_t i;
+
+	if (!lockstat_enabled)
+		return NULL;
+
+	old_level = intr_disable ();
+	for (i = (uintptr_t) site % LOCKSTAT_CLASSES; ;
+			i = (i + 1) % LOCKSTAT_CLASSES) {
+		struct lock_class *c = &lock_classes[i];
+
+		if (c->site == site) {
+			class = c;
+			break;
+		}
+		if (c->site == NULL) {
+			if (lock_class_cnt < LOCKSTAT_CLASSES - 1) {
+				c->site = site;
+				c->kind = kind;
+				lock_class_cnt++;
+				class = c;
+			} else
+				lock_class_overflow++;
+			break;
+		}
+	}
+	intr_set_level (old_level);
+	return class;
+}
+
+/* Counts an acquisition of a lock in CLASS, which took WAIT
+   cycles if CONTENDED.  Interrupts must be off. */
+static void
+lockstat_acquired (struct lock_class *class, bool contended, uint64_t wait) {
+	if (class == NULL)
+		return;
+
+	class->acquired++;
+	if (contended) {
+		class->contended++;
+		class->wait_total += wait;
+		if (wait > class->wait_max)
+			class->wait_max = wait;
+	}
+}
+
+/* Counts the release of a lock in CLASS that was acquired at TSC
+   ACQUIRED_AT.  Interrupts must be off. */
+static void
+lockstat_released (struct lock_class *class, uint64_t acquired_at) {
+	uint64_t hold;
+
+	if (class == NULL)
+		return;
+
+	hold = rdtsc () - acquired_at;
+	class->hold_total += hold;
+	if (hold > class->hold_max)
+		class->hold_max = hold;
+}
+
+/* Prints the lock classes that waited longest in total, or that
+   were acquired most often if none waited.  `backtrace' turns a
+   class's site into the function that initialized its locks. */
+void
+lockstat_print (void) {
+	static struct lock_class *sorted[LOCKSTAT_CLASSES];
+	size_t cnt = 0, i;
+
+	if (!lockstat_enabled)
+		return;
+
+	for (i = 0; i < LOCKSTAT_CLASSES; i++)
+		if (lock_classes[i].acquired > 0)
+			sorted[cnt++] = &lock_classes[i];
+	qsort (sorted, cnt, sizeof *sorted, lockstat_compare);
+
+	printf ("Lock statistics (TSC cycles, %zu classes, by total wait):\n",
+			cnt);
+	printf ("%-18s %-6s %10s %10s %14s %14s %14s %14s\n", "site", "kind",
+			"acquired", "contended", "wait", "wait max", "hold", "hold max");
+	for (i = 0; i < cnt && i < LOCKSTAT_REPORT; i++) {
+		const struct lock_class *c = sorted[i];
+
+		printf ("%-18p %-6s %10llu %10llu %14llu %14llu %14llu %14llu\n",
+				c->site, c->kind, c->acquired, c->contended, c->wait_total,
+				c->wait_max, c->hold_total, c->hold_max);
+	}
+	if (lock_class_overflow > 0)
+		printf ("%zu initializations found the class table full.\n",
+				lock_class_overflow);
+}
+
+/* Orders lock classes by total wait, then acquisitions, both
+   descending, for qsort(). */
+static int
+lockstat_compare (const void *a_, const void *b_) {
+	const struct lock_class *a = *(struct lock_class * const *) a_;
+	const struct lock_class *b = *(struct lock_class * const *) b_;
+
+	if (a->wait_total != b->wait_total)
+		return a->wait_total > b->wait_total ? -1 : 1;
+	if (a->acquired != b->acquired)
+		return a->acquired > b->acquired ? -1 : 1;
+	return 0;
+}
@@ -8,8 +8,11 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -27,11 +30,24 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+#if PRI_CNT > 64
+#error the run queue bitmap requires at most 64 priorities
+#endif
+
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running. */
+static struct runqueue ready_rq;
+
+/* List of all live threads.  Threads are added when they are
+   created and removed when they exit. */
+static struct list all_list;
 
-static struct list sleep_list;
+/* Threads blocked in thread_sleep(), ordered by tick_to_wake,
+   and the earliest tick_to_wake among them (INT64_MAX if none),
+   so that thread_wakeup() can return at once when no thread is
+   due. */
+static struct heap sleep_heap;
+static int64_t next_wakeup;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -42,9 +58,35 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Offset of `stack' member within `struct thread'.
+   Used by switch.S, which can't figure it out on its own. */
+uint32_t thread_stack_ofs = offsetof (struct thread, stack);
+
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Caches of freed thread pages and file descriptor tables.
+   Creating and destroying threads is frequent under fork-heavy
+   workloads, so instead of handing these back to palloc, which
+   zeroes every page it gives out, exiting threads park them
+   here for the next thread_create() to reuse.
+   Only the parts that must start out zero are cleared on reuse:
+   init_thread() clears struct thread, and thread_fdt_alloc()
+   clears the FDT_COUNT_LIMIT descriptor slots.
+
+   Each cached block links to the next through its first word.
+   The caches are bounded so that they cannot hoard memory, and
+   are drained when palloc runs out.  Accessed with interrupts
+   off, since do_schedule() fills the thread page cache. */
+#define BLOCK_CACHE_MAX 16      /* Max blocks kept per cache. */
+struct block_cache {
+	void *head;                 /* Most recently freed block. */
+	size_t cnt;                 /* # of blocks in cache. */
+	size_t page_cnt;            /* # of pages in each block. */
+};
+static struct block_cache thread_page_cache = { NULL, 0, 1 };
+static struct block_cache fdt_cache = { NULL, 0, FDT_PAGES };
+
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
@@ -59,11 +101,66 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, print every thread's scheduling statistics at power
+   off.  Controlled by kernel command-line option "-schedstat". */
+bool thread_schedstat;
+
+/* Scheduling statistics of threads that have exited. */
+static struct schedstat exited_stats;
+
+/* Multi-level feedback queue scheduler. */
+#define MLFQS_PRIORITY_TICKS 4  /* # of ticks between priority updates. */
+static fixed_t load_avg;        /* System load average. */
+
+/* Earliest-deadline-first class.  Bandwidth is runtime / period
+   in units of 1 / (1 << DL_BW_SHIFT), and admission control keeps
+   the sum over all deadline threads within DL_BW_LIMIT, leaving
+   the rest of the CPU to ordinary threads.  Threads that have
+   used up their budget wait for their next period in
+   dl_throttled_heap, ordered by dl_replenish. */
+#define DL_BW_SHIFT 20
+#define DL_BW_LIMIT ((95 << DL_BW_SHIFT) / 100)  /* 95% of the CPU. */
+static int64_t dl_total_bw;     /* Bandwidth admitted so far. */
+static struct heap dl_throttled_heap;
+
 static void kernel_thread (thread_func *, void *aux);
+static void launch_thread (void);
 
 static void idle (void *aux UNUSED);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static void rq_init (struct runqueue *);
+static void rq_push (struct runqueue *, struct thread *);
+static struct thread *rq_pop (struct runqueue *);
+static void rq_remove (struct runqueue *, struct thread *);
+static int rq_max_priority (const struct runqueue *);
+static bool rq_preempts (struct runqueue *, const struct thread *);
+static void ready_push (struct thread *);
+static int ready_count (void);
+static void set_priority (struct thread *, int priority);
+static void update_priority (struct thread *);
+static void hold_set_priority (struct thread *, struct hold *, int priority);
+static bool wakes_earlier (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static bool dl_active (const struct thread *);
+static int64_t dl_bandwidth (const struct thread *);
+static void dl_leave (struct thread *);
+static void dl_wakeup (struct thread *, int64_t now);
+static void dl_tick (struct thread *);
+static void dl_replenish_due (int64_t now);
+static bool deadline_earlier (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+static bool replenishes_earlier (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+static void schedstat_hist_add (uint32_t hist[], uint64_t cycles);
+static void schedstat_add (struct schedstat *, const struct schedstat *);
+static void schedstat_print_hist (const char *, const uint32_t hist[]);
+static void mlfqs_tick (struct thread *);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_update_recent_cpu (struct thread *, fixed_t decay);
+static void *block_cache_get (struct block_cache *);
+static bool block_cache_put (struct block_cache *, void *);
+static void block_cache_drain (struct block_cache *);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
@@ -112,8 +209,11 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&sleep_list);
+	rq_init (&ready_rq);
+	list_init (&all_list);
+	heap_init (&sleep_heap, wakes_earlier, NULL);
+	next_wakeup = INT64_MAX;
+	heap_init (&dl_throttled_heap, replenishes_earlier, NULL);
 	list_init (&destruction_req);
 
 	/* Set up a thread structure for the running thread. */
@@ -155,6 +255,17 @@ thread_tick (void) {
 	else
 		kernel_ticks++;
 
+	if (thread_mlfqs)
+		mlfqs_tick (t);
+
+	/* Charge deadline threads for their runtime and give throttled
+	   ones a new budget once their next period begins. */
+	if (t->dl_runtime > 0)
+		dl_tick (t);
+	dl_replenish_due (timer_ticks ());
+	if (rq_preempts (&ready_rq, t))
+		intr_yield_on_return ();
+
 	/* Enforce preemption. */
 	if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
@@ -165,6 +276,98 @@ void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+
+	if (thread_schedstat) {
+		struct schedstat total = exited_stats;
+		struct list_elem *e;
+
+		printf ("Scheduling statistics (TSC cycles):\n");
+		printf ("%5s %-16s %14s %14s %14s %8s %8s %8s\n", "tid", "name",
+				"run", "wait", "lock", "vol", "invol", "donated");
+		for (e = list_begin (&all_list); e != list_end (&all_list);
+				e = list_next (e)) {
+			struct thread *t = list_entry (e, struct thread, all_elem);
+			const struct schedstat *st = &t->stats;
+
+			printf ("%5d %-16s %14llu %14llu %14llu %8llu %8llu %8llu\n",
+					t->tid, t->name, st->run_time, st->wait_time, st->lock_time,
+					st->voluntary_switches, st->involuntary_switches,
+					st->donations);
+			schedstat_add (&total, st);
+		}
+		printf ("%5s %-16s %14llu %14llu %14llu %8llu %8llu %8llu\n",
+				"", "(all, incl. exited)", total.run_time, total.wait_time,
+				total.lock_time, total.voluntary_switches,
+				total.involuntary_switches, total.donations);
+		schedstat_print_hist ("Run-queue latency", total.wait_hist);
+		schedstat_print_hist ("Lock wait", total.lock_hist);
+	}
+}
+
+/* Copies the scheduling statistics of the thread with the given
+   TID to *ST.  Returns false if there is no such thread. */
+bool
+thread_get_schedstat (tid_t tid, struct schedstat *st) {
+	enum intr_level old_level = intr_disable ();
+	struct list_elem *e;
+	bool found = false;
+
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		if (t->tid == tid) {
+			*st = t->stats;
+			found = true;
+			break;
+		}
+	}
+	intr_set_level (old_level);
+	return found;
+}
+
+/* Records that the running thread was blocked for CYCLES TSC
+   cycles acquiring a lock. */
+void
+thread_account_lock_wait (uint64_t cycles) {
+	struct schedstat *st = &thread_current ()->stats;
+
+	st->lock_time += cycles;
+	schedstat_hist_add (st->lock_hist, cycles);
+}
+
+/* Counts a latency of CYCLES in HIST, a histogram of
+   SCHEDSTAT_BUCKETS log2-sized buckets. */
+static void
+schedstat_hist_add (uint32_t hist[], uint64_t cycles) {
+	int bucket = cycles != 0 ? 63 - __builtin_clzll (cycles) : 0;
+
+	if (bucket >= SCHEDSTAT_BUCKETS)
+		bucket = SCHEDSTAT_BUCKETS - 1;
+	hist[bucket]++;
+}
+
+/* Adds the statistics in SRC to DST. */
+static void
+schedstat_add (struct schedstat *dst, const struct schedstat *src) {
+	dst->run_time += src->run_time;
+	dst->wait_time += src->wait_time;
+	dst->lock_time += src->lock_time;
+	dst->voluntary_switches += src->voluntary_switches;
+	dst->involuntary_switches += src->involuntary_switches;
+	dst->donations += src->donations;
+	for (int i = 0; i < SCHEDSTAT_BUCKETS; i++) {
+		dst->wait_hist[i] += src->wait_hist[i];
+		dst->lock_hist[i] += src->lock_hist[i];
+	}
+}
+
+/* Prints the nonempty buckets of HIST under the heading NAME. */
+static void
+schedstat_print_hist (const char *name, const uint32_t hist[]) {
+	printf ("%s histogram (TSC cycles):\n", name);
+	for (int i = 0; i < SCHEDSTAT_BUCKETS; i++)
+		if (hist[i] != 0)
+			printf ("  %20llu+ %10u\n", i > 0 ? 1ULL << i : 0ULL, hist[i]);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -185,19 +388,35 @@ thread_print_stats (void) {
 tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
+	struct switch_threads_frame *sf;
 	struct thread *t;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 
-	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	/* Allocate thread.  There is no need for PAL_ZERO, because
+	   init_thread() clears struct thread and the rest of the page
+	   is stack. */
+	t = block_cache_get (&thread_page_cache);
+	if (t == NULL)
+		t = palloc_get_page (0);
+	if (t == NULL) {
+		block_cache_drain (&fdt_cache);
+		t = palloc_get_page (0);
+	}
 	if (t == NULL)
 		return TID_ERROR;
 
-	/* Initialize thread. */
+	/* Initialize thread.  Under the multi-level feedback queue
+	   scheduler the thread inherits its parent's niceness and
+	   recent_cpu, and PRIORITY is ignored. */
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
+	if (thread_mlfqs) {
+		t->nice = thread_current ()->nice;
+		t->recent_cpu = thread_current ()->recent_cpu;
+		t->priority = t->init_priority = mlfqs_priority (t);
+	}
 
 	/* Call the kernel_thread if it scheduled.
 	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
@@ -210,11 +429,26 @@ thread_create (const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
+	/* Stack frame for switch_threads().  It "returns" into
+	   launch_thread(), which enters kernel_thread() through the
+	   intr_frame above. */
+	sf = (struct switch_threads_frame *) ((uint8_t *) t + PGSIZE) - 1;
+	*sf = (struct switch_threads_frame) { .rip = launch_thread };
+	t->stack = (uint8_t *) sf;
+
 	/* Project 2 */
 	list_push_back(&thread_current()->child_list, &t->child_elem);
-	t->fd_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if (t->fd_table == NULL)
+	t->fd_table = thread_fdt_alloc ();
+	if (t->fd_table == NULL) {
+		enum intr_level old_level = intr_disable ();
+
+		list_remove (&t->all_elem);
+		list_remove (&t->child_elem);
+		intr_set_level (old_level);
+		if (!block_cache_put (&thread_page_cache, t))
+			palloc_free_page (t);
 		return TID_ERROR;
+	}
 
 	/* Add to run queue. */
 	thread_unblock (t);
@@ -222,13 +456,39 @@ thread_create (const char *name, int priority,
 	/* If the new thread has a higher priority than the running thread, 
 	   call schedule() -> current thread yields CPU control */
 	struct thread *curr = thread_current ();
-	if (t->priority > curr->priority) {
+	if (!dl_active (curr) && t->priority > curr->priority) {
 		thread_yield();
 	}
 
 	return tid;
 }
 
+/* Returns a cleared file descriptor table of FDT_COUNT_LIMIT
+   entries, spanning FDT_PAGES pages, or a null pointer if memory
+   is exhausted.  Free it with thread_fdt_free(). */
+struct file **
+thread_fdt_alloc (void) {
+	struct file **fdt = block_cache_get (&fdt_cache);
+
+	if (fdt == NULL)
+		fdt = palloc_get_multiple (0, FDT_PAGES);
+	if (fdt == NULL) {
+		block_cache_drain (&thread_page_cache);
+		fdt = palloc_get_multiple (0, FDT_PAGES);
+	}
+	if (fdt != NULL)
+		memset (fdt, 0, FDT_COUNT_LIMIT * sizeof *fdt);
+	return fdt;
+}
+
+/* Frees FDT, which must have come from thread_fdt_alloc().  The
+   caller must already have closed the files in it. */
+void
+thread_fdt_free (struct file **fdt) {
+	if (fdt != NULL && !block_cache_put (&fdt_cache, fdt))
+		palloc_free_multiple (fdt, FDT_PAGES);
+}
+
 /* Puts the current thread to sleep.  It will not be scheduled
    again until awoken by thread_unblock().
 
@@ -260,11 +520,11 @@ thread_unblock (struct thread *t) {
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
 
-	// list_push_back (&ready_list, &t->elem);
-	//When adding threads to ready_list, add them according to priority
-	list_insert_ordered(&ready_list, &t->elem, compare_priority, NULL); 
-
+	if (dl_active (t))
+		dl_wakeup (t, timer_ticks ());
+	t->stat_stamp = rdtsc ();
 	t->status = THREAD_READY;
+	ready_push (t);
 	intr_set_level (old_level);
 }
 
@@ -311,6 +571,8 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	list_remove (&thread_current ()->all_elem);
+	dl_leave (thread_current ());
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -329,7 +591,7 @@ thread_yield (void) {
 
 	old_level = intr_disable (); //인터럽트 비활성화
 	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, compare_priority, NULL); 
+		ready_push (curr);
 
 	//현재 실행중인 스레드의 상태를 스레드 준비 상태로 변경 및 컨텍스트 전환
 	do_schedule (THREAD_READY);
@@ -350,7 +612,9 @@ thread_sleep(int64_t ticks) {
 	old_level = intr_disable ();
 	if (curr != idle_thread) {
 		curr->tick_to_wake = ticks;  // 시간 저장
-		list_push_back (&sleep_list, &curr->elem);  //move to sleep list
+		heap_push (&sleep_heap, &curr->sleep_elem);  //move to sleep heap
+		if (ticks < next_wakeup)
+			next_wakeup = ticks;
 		thread_block();  //스레드의 상태를 블록 상태로 변경
 	}
 
@@ -358,27 +622,61 @@ thread_sleep(int64_t ticks) {
 }
 
 /* The function that find the thread to wake up 
-   from sleep queue and wake up it */
+   from sleep queue and wake up it.
+   Only the threads that are due are visited, and nothing at all
+   is done on the ticks before the earliest deadline.  Called from
+   the timer softirq, which runs with interrupts on; they are
+   turned off only to wake each thread. */
 // sleep queue에서 깨어날 쓰레드를 찾아서 깨워주는 기능
 void
 thread_wakeup (int64_t ticks) {
-	struct list_elem *curr;
-	curr = list_begin(&sleep_list);
-	
-	while(curr != list_end(&sleep_list)) {
-		struct thread *t = list_entry (curr, struct thread, elem);
-		if(ticks >= t->tick_to_wake) {
-			curr = list_remove(curr);  //remove from sleep list
-			thread_unblock(t);  //move to ready list
-		} else {
-			curr = list_next(curr);
-		}
+	enum intr_level old_level;
+
+	if (ticks < next_wakeup)
+		return;
+
+	old_level = intr_disable ();
+	while (!heap_empty (&sleep_heap)) {
+		struct thread *t = heap_entry (heap_top (&sleep_heap),
+				struct thread, sleep_elem);
+		if (ticks < t->tick_to_wake)
+			break;
+		heap_pop (&sleep_heap);  //remove from sleep heap
+		thread_unblock (t);  //move to ready list
+
+		/* Let pending interrupts in between wakeups. */
+		intr_set_level (old_level);
+		old_level = intr_disable ();
 	}
+
+	next_wakeup = heap_empty (&sleep_heap) ? INT64_MAX
+		: heap_entry (heap_top (&sleep_heap), struct thread, sleep_elem)->tick_to_wake;
+
+	/* A woken thread with an earlier deadline or a higher priority
+	   should not have to wait out the running thread's time
+	   slice. */
+	if (intr_context () && rq_preempts (&ready_rq, thread_current ()))
+		intr_yield_on_return ();
+	intr_set_level (old_level);
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Returns true if thread A is due to wake up before thread B in
+   the sleep heap. */
+static bool
+wakes_earlier (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct thread, sleep_elem)->tick_to_wake
+		< heap_entry (b, struct thread, sleep_elem)->tick_to_wake;
+}
+
+/* Sets the current thread's priority to NEW_PRIORITY.
+   Ignored under the multi-level feedback queue scheduler, which
+   computes priorities itself. */
 void
 thread_set_priority (int new_priority) {
+	if (thread_mlfqs)
+		return;
+
 	thread_current ()->init_priority = new_priority;
 	refresh_priority();
 	test_max_priority();
@@ -390,31 +688,314 @@ thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+	old_level = intr_disable ();
+	curr->nice = nice;
+	curr->priority = curr->init_priority = mlfqs_priority (curr);
+	intr_set_level (old_level);
+
+	test_max_priority ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int load_avg_100 = fp_round (fp_mul_int (load_avg, 100));
+	intr_set_level (old_level);
+
+	return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int recent_cpu_100 = fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+	intr_set_level (old_level);
+
+	return recent_cpu_100;
+}
+
+/* Multi-level feedback queue scheduler bookkeeping for one timer
+   tick, with T the running thread.  Runs in an external
+   interrupt context.
+
+   Only the running thread accumulates recent_cpu between
+   seconds, so only its priority can change and only it is
+   recomputed every MLFQS_PRIORITY_TICKS ticks.  Once per second
+   load_avg and every thread's recent_cpu decay, and that is the
+   only time all threads are visited. */
+static void
+mlfqs_tick (struct thread *t) {
+	int64_t now = timer_ticks ();
+
+	if (t != idle_thread)
+		t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+	if (now % TIMER_FREQ == 0) {
+		int ready_threads = ready_count () + (t != idle_thread);
+		fixed_t decay;
+		struct list_elem *e;
+
+		/* load_avg = (59/60) * load_avg + (1/60) * ready_threads. */
+		load_avg = fp_add (fp_div_int (fp_mul_int (load_avg, 59), 60),
+				fp_div_int (fp_from_int (ready_threads), 60));
+
+		/* decay = (2 * load_avg) / (2 * load_avg + 1). */
+		decay = fp_div (fp_mul_int (load_avg, 2),
+				fp_add_int (fp_mul_int (load_avg, 2), 1));
+
+		for (e = list_begin (&all_list); e != list_end (&all_list);
+				e = list_next (e)) {
+			struct thread *th = list_entry (e, struct thread, all_elem);
+			if (th == idle_thread)
+				continue;
+			mlfqs_update_recent_cpu (th, decay);
+			th->init_priority = mlfqs_priority (th);
+			set_priority (th, th->init_priority);
+		}
+	} else if (now % MLFQS_PRIORITY_TICKS == 0 && t != idle_thread) {
+		t->priority = t->init_priority = mlfqs_priority (t);
+	} else
+		return;
+
+	if (rq_preempts (&ready_rq, t))
+		intr_yield_on_return ();
+}
+
+/* Returns T's priority under the multi-level feedback queue
+   scheduler:
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), computed in fixed
+   point, truncated to an integer and clamped to
+   [PRI_MIN, PRI_MAX]. */
+static int
+mlfqs_priority (const struct thread *t) {
+	int priority = fp_to_int (fp_sub (fp_from_int (PRI_MAX - t->nice * 2),
+			fp_div_int (t->recent_cpu, 4)));
+
+	if (priority < PRI_MIN)
+		return PRI_MIN;
+	if (priority > PRI_MAX)
+		return PRI_MAX;
+	return priority;
+}
+
+/* Decays T's recent_cpu by DECAY and adds its niceness:
+   recent_cpu = decay * recent_cpu + nice. */
+static void
+mlfqs_update_recent_cpu (struct thread *t, fixed_t decay) {
+	t->recent_cpu = fp_add_int (fp_mul (decay, t->recent_cpu), t->nice);
+}
+
+/* Places the running thread in the earliest-deadline-first
+   class, reserving RUNTIME ticks of CPU time in every PERIOD
+   ticks, each due DEADLINE ticks after the period begins.  A
+   deadline thread runs ahead of every ordinary thread, and the
+   deadline thread with the earliest absolute deadline runs
+   first.  It should call thread_deadline_yield() at the end of
+   each period's work.
+
+   A thread that uses up its RUNTIME before then is throttled: it
+   falls back to its ordinary priority until its next period
+   begins, which is counted as a missed deadline.  This is the
+   constant bandwidth server rule, and it keeps one thread's
+   overrun from eating into the time reserved for the others.
+
+   Returns false, changing nothing, if the parameters do not
+   satisfy 0 < RUNTIME <= DEADLINE <= PERIOD or if admitting the
+   thread would push the total bandwidth of all deadline threads
+   past DL_BW_LIMIT.  A RUNTIME of 0 returns the thread to the
+   ordinary class and always succeeds. */
+bool
+thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+	int64_t bw = 0;
+	bool success;
+
+	if (runtime != 0) {
+		if (runtime < 0 || deadline < runtime || period < deadline)
+			return false;
+		bw = (runtime << DL_BW_SHIFT) / period;
+	}
+
+	old_level = intr_disable ();
+	success = dl_total_bw - dl_bandwidth (t) + bw <= DL_BW_LIMIT;
+	if (success) {
+		dl_leave (t);
+		dl_total_bw += bw;
+		t->dl_runtime = runtime;
+		t->dl_deadline = deadline;
+		t->dl_period = period;
+		t->dl_abs_deadline = timer_ticks () + deadline;
+		t->dl_budget = runtime;
+	}
+	intr_set_level (old_level);
+
+	if (success)
+		test_max_priority ();
+	return success;
+}
+
+/* Ends the running deadline thread's work for its current
+   period, and sleeps until the next period begins.  Finishing
+   after the current deadline counts as a miss. */
+void
+thread_deadline_yield (void) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+	int64_t now, release;
+
+	ASSERT (t->dl_runtime > 0);
+
+	old_level = intr_disable ();
+	now = timer_ticks ();
+	if (now > t->dl_abs_deadline)
+		t->dl_misses++;
+	if (t->dl_throttled) {
+		heap_remove (&dl_throttled_heap, &t->dl_elem);
+		t->dl_throttled = false;
+	}
+
+	/* Start the next period on time, or right away if we are
+	   already past it. */
+	release = t->dl_abs_deadline - t->dl_deadline + t->dl_period;
+	if (release < now)
+		release = now;
+	t->dl_abs_deadline = release + t->dl_deadline;
+	t->dl_budget = t->dl_runtime;
+	intr_set_level (old_level);
+
+	if (release > now)
+		thread_sleep (release);
+	else
+		thread_yield ();
+}
+
+/* Returns the number of deadlines the running thread has
+   missed. */
+int
+thread_get_deadline_misses (void) {
+	return thread_current ()->dl_misses;
+}
+
+/* Returns true if T is a deadline thread that has budget left,
+   and so belongs in a run queue's deadline heap. */
+static bool
+dl_active (const struct thread *t) {
+	return t->dl_runtime > 0 && !t->dl_throttled;
+}
+
+/* Returns the bandwidth reserved by T, in units of
+   1 / (1 << DL_BW_SHIFT). */
+static int64_t
+dl_bandwidth (const struct thread *t) {
+	return t->dl_runtime > 0 ? (t->dl_runtime << DL_BW_SHIFT) / t->dl_period : 0;
+}
+
+/* Takes T, which must not be THREAD_READY, out of the deadline
+   class and releases its bandwidth. */
+static void
+dl_leave (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status != THREAD_READY);
+
+	dl_total_bw -= dl_bandwidth (t);
+	if (t->dl_throttled)
+		heap_remove (&dl_throttled_heap, &t->dl_elem);
+	t->dl_runtime = 0;
+	t->dl_throttled = false;
+}
+
+/* Applies the constant bandwidth server's wakeup rule to deadline
+   thread T as it becomes ready at tick NOW.  If T's deadline has
+   passed, or running out its remaining budget before the deadline
+   would exceed its reserved bandwidth, T gets a fresh budget and
+   deadline; otherwise it carries on with the ones it has. */
+static void
+dl_wakeup (struct thread *t, int64_t now) {
+	if (t->dl_abs_deadline <= now
+			|| t->dl_budget * t->dl_period
+				> t->dl_runtime * (t->dl_abs_deadline - now)) {
+		t->dl_abs_deadline = now + t->dl_deadline;
+		t->dl_budget = t->dl_runtime;
+	}
+}
+
+/* Charges running deadline thread T for the current tick.  If
+   that exhausts its budget, T is throttled until its next period
+   begins. */
+static void
+dl_tick (struct thread *t) {
+	if (t->dl_throttled || --t->dl_budget > 0)
+		return;
+
+	t->dl_throttled = true;
+	t->dl_replenish = t->dl_abs_deadline - t->dl_deadline + t->dl_period;
+	heap_push (&dl_throttled_heap, &t->dl_elem);
+	intr_yield_on_return ();
+}
+
+/* Gives every throttled thread whose next period has begun by
+   tick NOW a fresh budget and deadline.  Each of them was still
+   busy at the end of its last period, so each has missed a
+   deadline. */
+static void
+dl_replenish_due (int64_t now) {
+	while (!heap_empty (&dl_throttled_heap)) {
+		struct thread *t = heap_entry (heap_top (&dl_throttled_heap),
+				struct thread, dl_elem);
+		struct runqueue *rq = &ready_rq;
+
+		if (now < t->dl_replenish)
+			break;
+		heap_pop (&dl_throttled_heap);
+
+		/* Move T from the priority queues to the deadline heap. */
+		if (t->status == THREAD_READY)
+			rq_remove (rq, t);
+		t->dl_throttled = false;
+		t->dl_misses++;
+		t->dl_abs_deadline = t->dl_replenish + t->dl_deadline;
+		if (t->dl_abs_deadline <= now)
+			t->dl_abs_deadline = now + t->dl_deadline;
+		t->dl_budget = t->dl_runtime;
+		if (t->status == THREAD_READY)
+			rq_push (rq, t);
+	}
+}
+
+/* Returns true if deadline thread A's absolute deadline is
+   earlier than B's. */
+static bool
+deadline_earlier (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct thread, dl_elem)->dl_abs_deadline
+		< heap_entry (b, struct thread, dl_elem)->dl_abs_deadline;
+}
+
+/* Returns true if throttled thread A is due to be replenished
+   before B. */
+static bool
+replenishes_earlier (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct thread, dl_elem)->dl_replenish
+		< heap_entry (b, struct thread, dl_elem)->dl_replenish;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -438,6 +1019,11 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* Nothing to do until the next interrupt, so there is no
+		   need for the periodic tick before the next sleeping
+		   thread is due. */
+		timer_idle_enter (next_wakeup);
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -469,19 +1055,24 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
 
 	memset (t, 0, sizeof *t);
 	t->status = THREAD_BLOCKED;
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = 0;
 	strlcpy (t->name, name, sizeof t->name);
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->init_priority = priority;
 	t->magic = THREAD_MAGIC;
+	t->stat_stamp = rdtsc ();
 	t->wait_on_lock = NULL;
-	list_init(&t->donations);
+	heap_init(&t->locks, compare_hold_priority, NULL);
 
 	t->exit_status = 0;
 	t->next_fd = 2;
@@ -489,19 +1080,159 @@ init_thread (struct thread *t, const char *name, int priority) {
 	sema_init(&t->exit_sema, 0);
 	sema_init(&t->wait_sema, 0);
 	list_init(&t->child_list);
+
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->all_elem);
+	intr_set_level (old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   the idle thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	struct thread *t;
+
+	t = rq_pop (&ready_rq);
+	if (t == NULL)
+		t = idle_thread;
+	return t;
+}
+
+/* Initializes RQ as an empty run queue. */
+static void
+rq_init (struct runqueue *rq) {
+	heap_init (&rq->dl_heap, deadline_earlier, NULL);
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init (&rq->queues[pri - PRI_MIN]);
+	rq->bitmap = 0;
+	rq->count = 0;
+}
+
+/* Adds T to RQ: to its deadline heap if T is an active deadline
+   thread, otherwise to the tail of the queue for T's current
+   priority. */
+static void
+rq_push (struct runqueue *rq, struct thread *t) {
+	int pri = t->priority - PRI_MIN;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	if (dl_active (t))
+		heap_push (&rq->dl_heap, &t->dl_elem);
+	else {
+		list_push_back (&rq->queues[pri], &t->elem);
+		rq->bitmap |= 1ULL << pri;
+	}
+	rq->count++;
+}
+
+/* Removes and returns the deadline thread with the earliest
+   deadline in RQ, or if there is none the oldest thread of the
+   highest nonempty priority, or a null pointer if RQ is empty. */
+static struct thread *
+rq_pop (struct runqueue *rq) {
+	struct thread *t = NULL;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!heap_empty (&rq->dl_heap)) {
+		t = heap_entry (heap_pop (&rq->dl_heap), struct thread, dl_elem);
+		rq->count--;
+	} else if (rq->bitmap != 0) {
+		int pri = rq_max_priority (rq) - PRI_MIN;
+
+		t = list_entry (list_pop_front (&rq->queues[pri]), struct thread, elem);
+		if (list_empty (&rq->queues[pri]))
+			rq->bitmap &= ~(1ULL << pri);
+		rq->count--;
+	}
+	return t;
+}
+
+/* Removes T, which must be THREAD_READY, from RQ. */
+static void
+rq_remove (struct runqueue *rq, struct thread *t) {
+	int pri = t->priority - PRI_MIN;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	if (dl_active (t))
+		heap_remove (&rq->dl_heap, &t->dl_elem);
+	else {
+		list_remove (&t->elem);
+		if (list_empty (&rq->queues[pri]))
+			rq->bitmap &= ~(1ULL << pri);
+	}
+	rq->count--;
+}
+
+/* Returns the highest priority of any thread in RQ, or
+   PRI_MIN - 1 if RQ is empty. */
+static int
+rq_max_priority (const struct runqueue *rq) {
+	uint64_t bitmap = rq->bitmap;
+
+	if (bitmap == 0)
+		return PRI_MIN - 1;
+	return PRI_MIN + 63 - __builtin_clzll (bitmap);
+}
+
+/* Returns true if RQ holds a thread that should run in place of
+   T.  Any deadline thread beats an ordinary one, deadline threads
+   are ordered by deadline and ordinary ones by priority. */
+static bool
+rq_preempts (struct runqueue *rq, const struct thread *t) {
+	if (!heap_empty (&rq->dl_heap)) {
+		struct thread *first = heap_entry (heap_top (&rq->dl_heap),
+				struct thread, dl_elem);
+		return !dl_active (t) || first->dl_abs_deadline < t->dl_abs_deadline;
+	}
+	return !dl_active (t) && rq_max_priority (rq) > t->priority;
+}
+
+/* Makes T, which must be THREAD_READY, runnable. */
+static void
+ready_push (struct thread *t) {
+	rq_push (&ready_rq, t);
+}
+
+/* Returns the number of ready threads. */
+static int
+ready_count (void) {
+	return ready_rq.count;
+}
+
+/* Changes T's effective priority to PRIORITY.  A ready thread
+   is moved to the tail of its new priority's queue so that the
+   run queue stays indexed by priority. */
+static void
+set_priority (struct thread *t, int priority) {
+	enum intr_level old_level = intr_disable ();
+
+	if (t->status == THREAD_READY && t->priority != priority) {
+		struct runqueue *rq = &ready_rq;
+
+		rq_remove (rq, t);
+		t->priority = priority;
+		rq_push (rq, t);
+	} else if (t->wait_on_rwlock != NULL && t->priority != priority) {
+		/* An rwlock's waiters are queued by priority. */
+		struct heap *waiters = t->wait_to_write
+			? &t->wait_on_rwlock->write_waiters
+			: &t->wait_on_rwlock->read_waiters;
+
+		heap_remove (waiters, &t->d_elem);
+		t->priority = priority;
+		heap_push (waiters, &t->d_elem);
+	} else
+		t->priority = priority;
+
+	intr_set_level (old_level);
 }
 
 /* Use iretq to launch the thread */
@@ -532,73 +1263,14 @@ do_iret (struct intr_frame *tf) {
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
-
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+/* First code run by a new thread, entered through the
+   switch_threads_frame that thread_create() put on its stack.
+   Starts the thread proper from its `tf' via do_iret(), which
+   also turns interrupts on. */
 static void
-thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
-	ASSERT (intr_get_level () == INTR_OFF);
-
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+launch_thread (void) {
+	do_iret (&running_thread ()->tf);
+	NOT_REACHED ();
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -612,7 +1284,8 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		if (!block_cache_put (&thread_page_cache, victim))
+			palloc_free_page(victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -626,6 +1299,7 @@ schedule (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
+	TRACE (SCHEDULE, next->tid, curr->status);
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
@@ -638,6 +1312,28 @@ schedule (void) {
 #endif
 
 	if (curr != next) {
+		/* Charge CURR for the time it ran and NEXT for the time it
+		   spent waiting in the run queue.  The idle thread does not
+		   wait there. */
+		uint64_t now = rdtsc ();
+
+		curr->stats.run_time += now - curr->stat_stamp;
+		if (curr->status == THREAD_READY)
+			curr->stats.involuntary_switches++;
+		else
+			curr->stats.voluntary_switches++;
+		curr->stat_stamp = now;
+		if (curr->status == THREAD_DYING)
+			schedstat_add (&exited_stats, &curr->stats);
+
+		if (next != idle_thread) {
+			uint64_t wait = now - next->stat_stamp;
+
+			next->stats.wait_time += wait;
+			schedstat_hist_add (next->stats.wait_hist, wait);
+		}
+		next->stat_stamp = now;
+
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
 		   pull out the rug under itself.
@@ -650,9 +1346,58 @@ schedule (void) {
 			list_push_back (&destruction_req, &curr->elem);
 		}
 
-		/* Before switching the thread, we first save the information
-		 * of current running. */
-		thread_launch (next);
+		/* Save the callee-saved registers and stack pointer of the
+		 * current thread and resume NEXT.  We come back here when
+		 * some later schedule() switches back to us. */
+		switch_threads (curr, next);
+	}
+}
+
+/* Removes and returns the most recently freed block in CACHE,
+   or a null pointer if CACHE is empty. */
+static void *
+block_cache_get (struct block_cache *cache) {
+	enum intr_level old_level = intr_disable ();
+	void **block = cache->head;
+
+	if (block != NULL) {
+		cache->head = *block;
+		cache->cnt--;
+	}
+	intr_set_level (old_level);
+	return block;
+}
+
+/* Adds BLOCK to CACHE and returns true, or returns false without
+   doing anything if CACHE is full. */
+static bool
+block_cache_put (struct block_cache *cache, void *block) {
+	enum intr_level old_level = intr_disable ();
+	bool ok = cache->cnt < BLOCK_CACHE_MAX;
+
+	if (ok) {
+		*(void **) block = cache->head;
+		cache->head = block;
+		cache->cnt++;
+	}
+	intr_set_level (old_level);
+	return ok;
+}
+
+/* Returns every block in CACHE to palloc. */
+static void
+block_cache_drain (struct block_cache *cache) {
+	enum intr_level old_level = intr_disable ();
+	void **block = cache->head;
+
+	cache->head = NULL;
+	cache->cnt = 0;
+	intr_set_level (old_level);
+
+	while (block != NULL) {
+		void **next = *block;
+		palloc_free_multiple (block, cache->page_cnt);
+		block = next;
 	}
 }
 
@@ -669,17 +1414,13 @@ allocate_tid (void) {
 	return tid;
 }
 /* Compare the priority of the current thread 
-   with the highest priority thread on ready_list,
+   with the highest priority thread in the run queue,
    if the current thread has a smaller priority, 
    Call thread_yield() */
 void 
 test_max_priority(void) {
-	if(!list_empty(&ready_list)) {
-		struct thread *curr = thread_current ();
-		struct thread *highest_priority = list_entry(list_front (&ready_list), struct thread, elem);
-		if (highest_priority->priority > curr->priority) {
-			if (!intr_context()) thread_yield();
-		}
+	if (rq_preempts (&ready_rq, thread_current ())) {
+		if (!intr_context()) thread_yield();
 	}
 }
 
@@ -699,50 +1440,209 @@ compare_priority(
 		return 0;
 }
 
+/* Returns true if the thread waiting on a lock through heap
+   element A has a higher priority than the one through B. */
 bool
 compare_donate_priority (
-	struct list_elem *a, 
-	struct list_elem *b, 
+	const struct heap_elem *a, 
+	const struct heap_elem *b, 
+	void *aux UNUSED
+) {
+	return heap_entry (a, struct thread, d_elem)->priority
+		 > heap_entry (b, struct thread, d_elem)->priority;
+}
+
+/* Returns true if hold A receives a higher donated priority
+   than hold B. */
+bool
+compare_hold_priority (
+	const struct heap_elem *a, 
+	const struct heap_elem *b, 
 	void *aux UNUSED
 ) {
-	return list_entry (a, struct thread, d_elem)->priority
-		 > list_entry (b, struct thread, d_elem)->priority;
+	return heap_entry (a, struct hold, elem)->priority
+		 > heap_entry (b, struct hold, elem)->priority;
+}
+
+/* Recomputes LOCK's priority from its waiters and, if it changed,
+   repositions LOCK in its holder's heap of held locks.  Returns
+   the holder if its priority may need updating, otherwise a null
+   pointer. */
+static struct thread *
+lock_update_priority (struct lock *lock) {
+	struct thread *holder = lock->holder;
+	int priority = heap_empty (&lock->waiters) ? PRI_MIN - 1
+		: heap_entry (heap_top (&lock->waiters), struct thread, d_elem)->priority;
+
+	if (priority == lock->hold.priority)
+		return NULL;
+
+	if (holder != NULL)
+		heap_remove (&holder->locks, &lock->hold.elem);
+	lock->hold.priority = priority;
+	if (holder != NULL)
+		heap_push (&holder->locks, &lock->hold.elem);
+	return holder;
+}
+
+/* Sets the priority of HOLD, which T holds, to PRIORITY and
+   recomputes T's priority. */
+static void
+hold_set_priority (struct thread *t, struct hold *hold, int priority) {
+	if (priority == hold->priority)
+		return;
+
+	heap_remove (&t->locks, &hold->elem);
+	hold->priority = priority;
+	heap_push (&t->locks, &hold->elem);
+	update_priority (t);
+}
+
+/* Recomputes T's priority as the higher of its own and the
+   highest donated by the waiters of the locks it holds, and
+   passes any change on along the chain of lock holders that T
+   is waiting behind.  Each step is O(lg n), and the chain is
+   followed as deep as it goes. */
+static void
+update_priority (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (t != NULL) {
+		struct lock *lock = t->wait_on_lock;
+		int priority = t->init_priority;
+		bool donated = false;
+
+		if (!heap_empty (&t->locks)) {
+			struct hold *top = heap_entry (heap_top (&t->locks), struct hold, elem);
+			if (top->priority > priority) {
+				priority = top->priority;
+				donated = true;
+			}
+		}
+		if (priority == t->priority)
+			break;
+		if (donated && priority > t->priority)
+			t->stats.donations++;
+
+		/* T's key in LOCK's waiters is its priority.  set_priority()
+		   repositions T among an rwlock's waiters itself. */
+		if (lock != NULL)
+			heap_remove (&lock->waiters, &t->d_elem);
+		set_priority (t, priority);
+		if (t->wait_on_rwlock != NULL) {
+			rwlock_update_priority (t->wait_on_rwlock);
+			break;
+		}
+		if (lock == NULL)
+			break;
+		heap_push (&lock->waiters, &t->d_elem);
+
+		t = lock_update_priority (lock);
+	}
 }
 
 /* 현재 쓰레드가 기다리고 있는 lock과 연결된 모든 쓰레드들을 순회하며,
    현재 쓰레드의 우선순위를 lock을 보유하고 있는 쓰레드에게 기부 */
+/* Makes the current thread a waiter of wait_on_lock and donates
+   its priority to the lock's holder, and on through the holders
+   of any locks the holder is itself waiting on. */
 void 
 donate_priority(void) {
-	int depth;
     struct thread *curr = thread_current();
-    
-	// Thread traverses connected to a lock that the thread is currently waiting for
-    for (depth = 0; depth < 8; depth++) {  // Nested depth limited to 8
-    	if (!curr->wait_on_lock) // Exit if there is no lock waiting
-        	break;
+	struct lock *lock = curr->wait_on_lock;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (lock != NULL);
 
-		// Donate the priority of the current thread to the thread that holds the lock
-        struct thread *holder = curr->wait_on_lock->holder;
-        holder->priority = curr->priority;
-        curr = holder;
-    }
+	heap_push (&lock->waiters, &curr->d_elem);
+	update_priority (lock_update_priority (lock));
+}
+
+/* Called once the current thread has acquired LOCK.  Stops
+   waiting on LOCK, if it was, and starts receiving the donations
+   of LOCK's remaining waiters. */
+void
+insert_with_lock (struct lock *lock) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (lock->holder == curr);
+
+	if (curr->wait_on_lock == lock) {
+		heap_remove (&lock->waiters, &curr->d_elem);
+		curr->wait_on_lock = NULL;
+	}
+
+	lock->hold.priority = heap_empty (&lock->waiters) ? PRI_MIN - 1
+		: heap_entry (heap_top (&lock->waiters), struct thread, d_elem)->priority;
+	heap_push (&curr->locks, &lock->hold.elem);
+	update_priority (curr);
 }
 
 // lock을 해지 했을 때, waiters 리스트에서 해당 엔트리를 삭제 하기 위한 함수를 구현
-/* Implement a function to delete the entry 
-   from the waiters list when cancel the lock */
+/* Implement a function to stop receiving the donations of LOCK's
+   waiters when cancel the lock */
 void 
 remove_with_lock (struct lock *lock) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	heap_remove (&thread_current ()->locks, &lock->hold.elem);
+}
+
+/* Called once T has been granted an rwlock through HOLD, whose
+   waiters donate PRIORITY.  Starts T receiving their donations. */
+void
+insert_with_hold (struct thread *t, struct hold *hold, int priority) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	hold->priority = priority;
+	heap_push (&t->locks, &hold->elem);
+	update_priority (t);
+}
+
+/* Called once T has given up HOLD.  Stops T receiving the
+   donations of its waiters. */
+void
+remove_with_hold (struct thread *t, struct hold *hold) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	heap_remove (&t->locks, &hold->elem);
+	update_priority (t);
+}
+
+/* Recomputes the priority RWLOCK's waiters donate and, if it
+   changed, passes it on to the writer or to each of the readers
+   holding RWLOCK.  The multi-level feedback queue scheduler does
+   not donate. */
+void
+rwlock_update_priority (struct rwlock *rwlock) {
+	int priority = PRI_MIN - 1;
 	struct list_elem *e;
-	struct thread *curr = thread_current ();
 
-	// 현재 쓰레드의 waiters 리스트를 확인하여 해지할 lock을 보유하고 있는 엔트리를 삭제
-	// Check the waiters list in the current thread 
-	// to delete the entry that holds the lock to be revoked
-	for (e = list_begin (&curr->donations); e != list_end (&curr->donations); e = list_next (e)){
-		struct thread *t = list_entry (e, struct thread, d_elem);
-		if (t->wait_on_lock == lock)
-			list_remove (&t->d_elem);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_mlfqs)
+		return;
+
+	if (!heap_empty (&rwlock->read_waiters))
+		priority = heap_entry (heap_top (&rwlock->read_waiters),
+				struct thread, d_elem)->priority;
+	if (!heap_empty (&rwlock->write_waiters)) {
+		int w = heap_entry (heap_top (&rwlock->write_waiters),
+				struct thread, d_elem)->priority;
+		if (w > priority)
+			priority = w;
+	}
+	if (priority == rwlock->priority)
+		return;
+	rwlock->priority = priority;
+
+	if (rwlock->writer != NULL)
+		hold_set_priority (rwlock->writer, &rwlock->hold, priority);
+	for (e = list_begin (&rwlock->readers); e != list_end (&rwlock->readers);
+			e = list_next (e)) {
+		struct rwlock_reader *r = list_entry (e, struct rwlock_reader, elem);
+		hold_set_priority (r->thread, &r->hold, priority);
 	}
 }
 
@@ -751,19 +1651,7 @@ remove_with_lock (struct lock *lock) {
    when the priority of a thread is changed */
 void
 refresh_priority (void) {
-	struct thread *curr = thread_current ();
-
-	// Change the priority of the current thread to the priority before it is donated
-	curr->priority = curr->init_priority;
-	
-	if (!list_empty (&curr->donations)) {
-		list_sort (&curr->donations, compare_donate_priority, 0);
-
-		// 현재 쓰레드의 waiters 리스트에서 가장 높은 우선순위를 현재 쓰레드의 우선순위와 비교
-		// Compare the highest priority in the waiters list of the current thread 
-		// with the priority of the current thread
-		struct thread *front = list_entry (list_front (&curr->donations), struct thread, d_elem);
-		if (front->priority > curr->priority)
-			curr->priority = front->priority;  // Set the priority of the current thread
-	}
-}
\ No newline at end of file
+	enum intr_level old_level = intr_disable ();
+	update_priority (thread_current ());
+	intr_set_level (old_level);
+}
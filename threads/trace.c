@@ -0,0 +1,115 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Trace buffer.
+
+   A ring of fixed-size binary records.  trace_record() claims
+   the next slot with an atomic increment of the head and then
+   fills it in, so an interrupt handler that traces in the middle
+   of it simply takes the following slot.  When the ring fills up,
+   the oldest records are overwritten.
+
+   The buffer is printed at power off, one record per line, so
+   that it can be recovered from the serial console output of any
+   run without a file system or scratch disk. */
+
+/* One record. */
+struct trace_rec {
+	uint64_t tsc;                       /* Time stamp counter. */
+	int32_t tid;                        /* Thread that recorded it. */
+	uint32_t event;                     /* enum trace_event. */
+	uint64_t arg[2];                    /* Event arguments. */
+};
+
+/* Names of events, for trace_dump(). */
+static const char *trace_events[TRACE_EVENT_CNT] = {
+	[TRACE_SCHEDULE] = "schedule",
+	[TRACE_FAULT_ENTER] = "fault_enter",
+	[TRACE_FAULT_EXIT] = "fault_exit",
+	[TRACE_DISK_READ_ENTER] = "disk_read_enter",
+	[TRACE_DISK_READ_EXIT] = "disk_read_exit",
+	[TRACE_DISK_WRITE_ENTER] = "disk_write_enter",
+	[TRACE_DISK_WRITE_EXIT] = "disk_write_exit",
+	[TRACE_SYSCALL_ENTER] = "syscall_enter",
+	[TRACE_SYSCALL_EXIT] = "syscall_exit",
+	[TRACE_LOCK_WAIT_ENTER] = "lock_wait_enter",
+	[TRACE_LOCK_WAIT_EXIT] = "lock_wait_exit",
+};
+
+/* Set by "-trace" to the size of the trace buffer in pages, or 0
+   if tracing is off. */
+int trace_pages;
+
+/* Recording? */
+bool trace_enabled;
+
+static struct trace_rec *trace_buf;     /* Ring of records. */
+static size_t trace_cap;                /* Number of records in ring. */
+static uint64_t trace_head;             /* Records ever claimed. */
+
+/* Allocates the trace buffer and starts tracing, if "-trace" was
+   given.  The page allocator must be initialized. */
+void
+trace_init (void) {
+	if (trace_pages <= 0)
+		return;
+
+	trace_buf = palloc_get_multiple (0, trace_pages);
+	if (trace_buf == NULL) {
+		printf ("trace: cannot allocate %d pages, tracing disabled\n",
+				trace_pages);
+		trace_pages = 0;
+		return;
+	}
+	trace_cap = trace_pages * PGSIZE / sizeof *trace_buf;
+	trace_enabled = true;
+}
+
+/* Appends a record of EVENT with arguments ARG0 and ARG1.  Use
+   TRACE() instead of calling this directly. */
+void
+trace_record (enum trace_event event, uint64_t arg0, uint64_t arg1) {
+	uint64_t slot = __atomic_fetch_add (&trace_head, 1, __ATOMIC_RELAXED);
+	struct trace_rec *r = &trace_buf[slot % trace_cap];
+
+	/* The running thread, found the way running_thread() does, as
+	   thread_current() would object to a thread in the middle of
+	   schedule(). */
+	r->tsc = rdtsc ();
+	r->tid = ((struct thread *) pg_round_down (rrsp ()))->tid;
+	r->event = event;
+	r->arg[0] = arg0;
+	r->arg[1] = arg1;
+}
+
+/* Stops tracing and prints the trace buffer, oldest record
+   first, for utils/trace2json. */
+void
+trace_dump (void) {
+	uint64_t head, first, i;
+	int e;
+
+	if (trace_buf == NULL)
+		return;
+
+	trace_enabled = false;
+	head = __atomic_load_n (&trace_head, __ATOMIC_RELAXED);
+	first = head > trace_cap ? head - trace_cap : 0;
+	printf ("Trace: %"PRIu64" records (%"PRIu64" kept), %"PRIu64" Hz TSC\n",
+			head, head - first, timer_tsc_hz ());
+	for (e = 0; e < TRACE_EVENT_CNT; e++)
+		printf ("TRACE-EVENT: %d %s\n", e, trace_events[e]);
+	for (i = first; i < head; i++) {
+		const struct trace_rec *r = &trace_buf[i % trace_cap];
+
+		printf ("TRACE: %"PRIx64" %"PRId32" %"PRIu32" %"PRIx64" %"PRIx64"\n",
+				r->tsc, r->tid, r->event, r->arg[0], r->arg[1]);
+	}
+}
@@ -0,0 +1,195 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Shared queues, at default and at high priority. */
+struct workqueue *system_wq;
+struct workqueue *system_highpri_wq;
+
+/* A work item that flush_workqueue() waits for. */
+struct barrier {
+	struct work work;
+	struct semaphore done;
+};
+
+static thread_func worker_func;
+static void delayed_work_timer (struct hrtimer *);
+static void barrier_func (struct work *);
+
+/* Creates the shared queues.  The scheduler must be running. */
+void
+workqueue_init (void) {
+	system_wq = workqueue_create ("kworker", PRI_DEFAULT);
+	system_highpri_wq = workqueue_create ("kworker-high", PRI_MAX);
+	if (system_wq == NULL || system_highpri_wq == NULL)
+		PANIC ("cannot create system workqueues");
+}
+
+/* Creates and returns a workqueue whose work runs in a new
+   thread named NAME at PRIORITY, or returns a null pointer if
+   memory is short.  NAME is not copied. */
+struct workqueue *
+workqueue_create (const char *name, int priority) {
+	struct workqueue *wq = malloc (sizeof *wq);
+
+	if (wq == NULL)
+		return NULL;
+	wq->name = name;
+	list_init (&wq->works);
+	sema_init (&wq->ready, 0);
+	if (thread_create (name, priority, worker_func, wq) == TID_ERROR) {
+		free (wq);
+		return NULL;
+	}
+	return wq;
+}
+
+/* Waits until all the work queued on WQ so far has run.  Must not
+   be called by WQ's own work, which would wait for itself. */
+void
+flush_workqueue (struct workqueue *wq) {
+	struct barrier b;
+
+	ASSERT (!intr_context ());
+
+	work_init (&b.work, barrier_func);
+	sema_init (&b.done, 0);
+	queue_work (wq, &b.work);
+	sema_down (&b.done);
+}
+
+/* Initializes WORK to call FUNC. */
+void
+work_init (struct work *work, work_func *func) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->pending = false;
+}
+
+/* Queues WORK on WQ, unless it is already queued.  Returns true
+   if WORK was queued, false if it already was.  May be called
+   from an interrupt handler.
+
+   WORK may be queued again as soon as its function starts, for
+   example by the function itself. */
+bool
+queue_work (struct workqueue *wq, struct work *work) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (work != NULL);
+
+	old_level = intr_disable ();
+	if (!work->pending) {
+		work->pending = true;
+		list_push_back (&wq->works, &work->elem);
+		sema_up (&wq->ready);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Initializes DW to call FUNC. */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func) {
+	work_init (&dw->work, func);
+	dw->wq = NULL;
+	hrtimer_init (&dw->timer, delayed_work_timer);
+}
+
+/* Queues DW on WQ after DELAY_NS nanoseconds, unless it is
+   already waiting out a delay or queued.  Returns true if DW
+   was scheduled, false if it already was.  May be called from an
+   interrupt handler. */
+bool
+queue_delayed_work (struct workqueue *wq, struct delayed_work *dw,
+		int64_t delay_ns) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (dw != NULL);
+
+	old_level = intr_disable ();
+	if (!dw->work.pending && !dw->timer.active) {
+		dw->wq = wq;
+		if (delay_ns <= 0)
+			queue_work (wq, &dw->work);
+		else
+			hrtimer_start (&dw->timer, timer_ns () + delay_ns);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Cancels DW if it is waiting out its delay or is queued but has
+   not started to run.  Returns true if DW was cancelled, false
+   if it was not scheduled or is already running. */
+bool
+cancel_delayed_work (struct delayed_work *dw) {
+	enum intr_level old_level;
+	bool cancelled;
+
+	ASSERT (dw != NULL);
+
+	old_level = intr_disable ();
+	cancelled = hrtimer_cancel (&dw->timer);
+	if (!cancelled && dw->work.pending) {
+		/* This leaves an extra count in the queue's semaphore,
+		   which the worker shrugs off. */
+		list_remove (&dw->work.elem);
+		dw->work.pending = false;
+		cancelled = true;
+	}
+	intr_set_level (old_level);
+	return cancelled;
+}
+
+/* A workqueue's worker thread.  Runs the work on WQ_ in the order
+   it was queued. */
+static void
+worker_func (void *wq_) {
+	struct workqueue *wq = wq_;
+
+	for (;;) {
+		struct work *work = NULL;
+		enum intr_level old_level;
+
+		sema_down (&wq->ready);
+		old_level = intr_disable ();
+		if (!list_empty (&wq->works)) {
+			work = list_entry (list_pop_front (&wq->works), struct work, elem);
+			work->pending = false;
+		}
+		intr_set_level (old_level);
+
+		if (work != NULL)
+			work->func (work);
+	}
+}
+
+/* Queues the delayed work whose delay TIMER measured.  Runs in
+   the timer interrupt. */
+static void
+delayed_work_timer (struct hrtimer *timer) {
+	struct delayed_work *dw = (struct delayed_work *) ((uint8_t *) timer
+			- offsetof (struct delayed_work, timer));
+
+	queue_work (dw->wq, &dw->work);
+}
+
+/* Wakes up flush_workqueue(). */
+static void
+barrier_func (struct work *work) {
+	struct barrier *b = (struct barrier *) ((uint8_t *) work
+			- offsetof (struct barrier, work));
+
+	sema_up (&b->done);
+}
@@ -0,0 +1,271 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <futex.h>
+#include <hash.h>
+#include <list.h>
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#ifdef VM
+#include "filesys/file.h"
+#include "userprog/process.h"
+#include "vm/vm.h"
+#endif
+
+/* Fast user-space mutexes.
+
+   A futex is just an int in user memory.  User code manipulates
+   it with atomic instructions and calls into the kernel only to
+   sleep until the int changes or to wake the threads sleeping on
+   it.  The kernel keeps no state for a futex that no one waits on:
+   waiters are keyed on where the int lives and hashed into one of
+   FUTEX_BUCKETS wait queues.
+
+   A process has a single thread, so futexes are contended only
+   between processes, through the one kind of memory they share:
+   a file mapping inherited across fork(), whose pages the parent
+   and child map to the same frames.  A futex in a file mapping is
+   keyed on the file's inode and the offset in the file, so that
+   every process mapping it finds the same waiters.  Any other
+   futex is keyed on the page table and user virtual address.
+
+   A bucket's lock orders FUTEX_WAIT's check of the int against
+   FUTEX_WAKE, so that a wakeup that follows a change to the int
+   cannot slip in between the check and the sleep.  The int's page
+   is made present and pinned before the lock is taken, so that
+   reading it under the lock cannot fault: a bad address exits the
+   process with no lock held. */
+
+#define FUTEX_BUCKETS 64
+
+/* A wait queue. */
+struct futex_bucket {
+	struct lock lock;           /* Protects waiters. */
+	struct list waiters;        /* struct futex_waiter, by priority. */
+};
+
+/* Identifies a futex. */
+struct futex_key {
+	const void *object;         /* Inode or page table... */
+	uintptr_t offset;           /* ...and file offset or user address. */
+};
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter {
+	struct list_elem elem;      /* Element in bucket's waiters. */
+	struct thread *thread;      /* The sleeping thread. */
+	struct futex_key key;       /* Futex waited on. */
+	bool queued;                /* In a bucket's waiters? */
+	struct semaphore sema;      /* Up'd to wake the thread. */
+	struct hrtimer timer;       /* Timeout. */
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+static void futex_key (const int *uaddr, struct futex_key *);
+static bool key_equal (const struct futex_key *, const struct futex_key *);
+static struct futex_bucket *futex_bucket (const struct futex_key *);
+static struct futex_bucket *lock_waiter_bucket (struct futex_waiter *);
+static bool waiter_more_priority (const struct list_elem *,
+		const struct list_elem *, void *aux);
+static void futex_timeout (struct hrtimer *);
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void) {
+	size_t i;
+
+	for (i = 0; i < FUTEX_BUCKETS; i++) {
+		lock_init (&buckets[i].lock);
+		list_init (&buckets[i].waiters);
+	}
+}
+
+/* If *UADDR equals VAL, sleeps until futex_wake() or
+   futex_requeue() wakes us or, if TIMEOUT_US is not negative,
+   until TIMEOUT_US microseconds pass.  Returns 0 if woken,
+   FUTEX_EAGAIN if *UADDR was not VAL, or FUTEX_ETIMEDOUT. */
+int
+futex_wait (const int *uaddr, int val, int64_t timeout_us) {
+	struct thread *curr = thread_current ();
+	struct futex_waiter w;
+	struct futex_bucket *b;
+	int result = 0;
+
+	w.thread = curr;
+	w.queued = true;
+	sema_init (&w.sema, 0);
+
+	pin_buffer ((void *) uaddr, sizeof *uaddr, false);
+	futex_key (uaddr, &w.key);
+	b = futex_bucket (&w.key);
+	lock_acquire (&b->lock);
+	if (*uaddr != val) {
+		lock_release (&b->lock);
+		unpin_buffer ((void *) uaddr, sizeof *uaddr);
+		return FUTEX_EAGAIN;
+	}
+	list_insert_ordered (&b->waiters, &w.elem, waiter_more_priority, NULL);
+	if (timeout_us >= 0) {
+		hrtimer_init (&w.timer, futex_timeout);
+		hrtimer_start (&w.timer, timer_ns () + timeout_us * 1000);
+	}
+	lock_release (&b->lock);
+	unpin_buffer ((void *) uaddr, sizeof *uaddr);
+
+	sema_down (&w.sema);
+	if (timeout_us >= 0)
+		hrtimer_cancel (&w.timer);
+
+	/* If no one dequeued us, we timed out. */
+	b = lock_waiter_bucket (&w);
+	if (w.queued) {
+		list_remove (&w.elem);
+		w.queued = false;
+		result = FUTEX_ETIMEDOUT;
+	}
+	lock_release (&b->lock);
+	return result;
+}
+
+/* Wakes up to CNT threads waiting on UADDR, highest priority
+   first.  Returns the number woken. */
+int
+futex_wake (const int *uaddr, int cnt) {
+	return futex_requeue (uaddr, cnt, NULL, 0);
+}
+
+/* Wakes up to CNT threads waiting on UADDR, highest priority
+   first, and then moves up to CNT2 of the others to wait on
+   UADDR2 instead.  Returns the number woken or moved. */
+int
+futex_requeue (const int *uaddr, int cnt, const int *uaddr2, int cnt2) {
+	struct futex_key key, key2;
+	struct futex_bucket *b, *b2 = NULL;
+	struct list_elem *e;
+	int woken = 0, moved = 0;
+
+	futex_key (uaddr, &key);
+	b = futex_bucket (&key);
+	if (cnt2 > 0) {
+		futex_key (uaddr2, &key2);
+		if (key_equal (&key, &key2))
+			cnt2 = 0;
+		else
+			b2 = futex_bucket (&key2);
+	}
+
+	/* Take both buckets' locks in address order. */
+	if (b2 != NULL && b2 < b)
+		lock_acquire (&b2->lock);
+	lock_acquire (&b->lock);
+	if (b2 != NULL && b2 > b)
+		lock_acquire (&b2->lock);
+
+	/* Priorities may have changed since the waiters queued. */
+	list_sort (&b->waiters, waiter_more_priority, NULL);
+	for (e = list_begin (&b->waiters);
+			e != list_end (&b->waiters) && (woken < cnt || moved < cnt2); ) {
+		struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+		e = list_next (e);
+		if (!key_equal (&w->key, &key))
+			continue;
+
+		list_remove (&w->elem);
+		if (woken < cnt) {
+			w->queued = false;
+			sema_up (&w->sema);
+			woken++;
+		} else {
+			w->key = key2;
+			list_insert_ordered (&b2->waiters, &w->elem,
+					waiter_more_priority, NULL);
+			moved++;
+		}
+	}
+
+	if (b2 != NULL && b2 != b)
+		lock_release (&b2->lock);
+	lock_release (&b->lock);
+	return woken + moved;
+}
+
+/* Sets KEY to identify the futex at UADDR in the current process:
+   the file and offset it is mapped from, if it is in a file
+   mapping, otherwise the page table and UADDR. */
+static void
+futex_key (const int *uaddr, struct futex_key *key) {
+	struct thread *curr = thread_current ();
+#ifdef VM
+	struct page *page = spt_find_page (&curr->spt, (void *) uaddr);
+
+	if (page != NULL && page_get_type (page) == VM_FILE) {
+		struct file *file;
+		off_t ofs;
+
+		if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+			struct lazy_load_arg *arg = page->uninit.aux;
+
+			file = arg->file;
+			ofs = arg->ofs;
+		} else {
+			file = page->file.file;
+			ofs = page->file.ofs;
+		}
+		key->object = file_get_inode (file);
+		key->offset = ofs + pg_ofs (uaddr);
+		return;
+	}
+#endif
+	key->object = curr->pml4;
+	key->offset = (uintptr_t) uaddr;
+}
+
+/* Returns true if A and B identify the same futex. */
+static bool
+key_equal (const struct futex_key *a, const struct futex_key *b) {
+	return a->object == b->object && a->offset == b->offset;
+}
+
+/* Returns the bucket for the futex identified by KEY. */
+static struct futex_bucket *
+futex_bucket (const struct futex_key *key) {
+	return &buckets[hash_bytes (key, sizeof *key) % FUTEX_BUCKETS];
+}
+
+/* Acquires the lock of the bucket that W is in, or was last in,
+   and returns the bucket.  futex_requeue() may move W to another
+   bucket until we hold its lock. */
+static struct futex_bucket *
+lock_waiter_bucket (struct futex_waiter *w) {
+	for (;;) {
+		struct futex_bucket *b = futex_bucket (&w->key);
+
+		lock_acquire (&b->lock);
+		if (b == futex_bucket (&w->key))
+			return b;
+		lock_release (&b->lock);
+	}
+}
+
+/* Returns true if waiter A's thread has a higher priority than
+   waiter B's. */
+static bool
+waiter_more_priority (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct futex_waiter, elem)->thread->priority
+		> list_entry (b, struct futex_waiter, elem)->thread->priority;
+}
+
+/* Wakes the waiter whose timeout TIMER is.  The waiter dequeues
+   itself. */
+static void
+futex_timeout (struct hrtimer *timer) {
+	struct futex_waiter *w = (struct futex_waiter *) ((uint8_t *) timer
+			- offsetof (struct futex_waiter, timer));
+
+	sema_up (&w->sema);
+}
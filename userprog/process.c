@@ -14,6 +14,7 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -152,7 +153,7 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 	/* 4. TODO: Duplicate parent's page to the new page and
 	 *    TODO: check whether parent's page is writable or not (set WRITABLE
 	 *    TODO: according to the result). */
-	memcpy(newpage, parent_page, PGSIZE);
+	copy_page (newpage, parent_page);
 	writable = is_writable(pte); // *PTE is an address that points to parent_page
 
 	/* 5. Add new page to child's page table at address VA with WRITABLE
@@ -358,7 +359,7 @@ process_exit (void) {
 			close(i);
 	}
 	// for multi-oom(메모리 누수)
-	palloc_free_multiple(curr->fd_table, FDT_PAGES);
+	thread_fdt_free (curr->fd_table);
 	file_close(curr->running);  // for rox- (실행중에 수정 못하도록)
 
 	process_cleanup();
@@ -780,7 +781,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+		struct lazy_load_arg *lazy_load_arg = kmem_cache_alloc (lazy_load_arg_cache);
 		lazy_load_arg->file = file;					   // 내용이 담긴 파일 객체
 		lazy_load_arg->ofs = ofs;					   // 이 페이지에서 읽기 시작할 위치
 		lazy_load_arg->read_bytes = page_read_bytes;   // 이 페이지에서 읽어야 하는 바이트 수
@@ -1,5 +1,7 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
+#include <futex.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -7,6 +9,7 @@
 #include "userprog/gdt.h"
 #include "threads/flags.h"
 #include "threads/palloc.h"
+#include "threads/trace.h"
 #include "intrinsic.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
@@ -14,6 +17,7 @@
 #include "filesys/fat.h"
 #include "filesys/inode.h"
 #include "userprog/process.h"
+#include "userprog/futex.h"
 #include "lib/kernel/stdio.h"
 #include "include/lib/stdio.h"
 #include "include/vm/vm.h"
@@ -50,6 +54,8 @@ bool readdir (int fd, char *name);
 bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char *target, const char *linkpath);
+bool schedstat (int pid, struct schedstat *st);
+int futex (int *addr, int op, int val, int64_t timeout, int *addr2);
 
 /* System call.
  *
@@ -64,11 +70,9 @@ int symlink (const char *target, const char *linkpath);
 #define MSR_LSTAR 0xc0000082        /* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
 
-struct lock file_rw_lock;
-
 void
 syscall_init (void) {
-	lock_init (&file_rw_lock);
+	futex_init ();
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -83,6 +87,7 @@ syscall_init (void) {
 /* The main system call interface */
 void
 syscall_handler (struct intr_frame *f UNUSED) {
+	uint64_t syscall_no = f->R.rax;
 	
 	// 함수 return 값에 대한 x86-64 convention은 이 값을 rax레지스터에 배치하는 것이다.
     // 값을 반환하는 system call은 struct int_frame의 rax 멤버를 수정함으로써 convention을 지킨다.
@@ -91,6 +96,7 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	thread_current()->rsp = f->rsp;
 	
 #endif 
+	TRACE (SYSCALL_ENTER, syscall_no, f->R.rdi);
 	switch (f->R.rax) { // rax is system call number
 		case SYS_HALT:
 			halt();
@@ -160,10 +166,18 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_SYMLINK:
 			f->R.rax = symlink(f->R.rdi, f->R.rsi);
 			break;
+		case SYS_SCHEDSTAT:
+			f->R.rax = schedstat(f->R.rdi, (struct schedstat *) f->R.rsi);
+			break;
+		case SYS_FUTEX:
+			f->R.rax = futex((int *) f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10,
+					(int *) f->R.r8);
+			break;
 		default:
 			exit(-1);
 			break;
     }
+	TRACE (SYSCALL_EXIT, syscall_no, f->R.rax);
 }
 
 /// Helper Functions
@@ -178,6 +192,53 @@ void check_address(void *addr) {
 	// if (pml4_get_page(thread_current()->pml4, addr) == NULL)
 	// 	exit(-1);
 }
+
+/* Most bytes of a read() or write() buffer pinned at once. */
+#define PIN_MAX (256 * PGSIZE)
+
+/* Makes the user pages covering SIZE bytes at BUFFER present, for
+   writing if WRITE, and under VM pins their frames until
+   unpin_buffer(), so that the file system can copy to or from BUFFER
+   while holding an inode lock that a fault on it would need.  Touching
+   the pages here, with no lock held, exits the process if BUFFER is
+   not valid. */
+void
+pin_buffer (void *buffer, size_t size, bool write) {
+	uint8_t *upage;
+
+	for (upage = pg_round_down (buffer); upage < (uint8_t *) buffer + size;
+			upage += PGSIZE) {
+		volatile uint8_t *p = upage < (uint8_t *) buffer ? buffer : upage;
+
+		check_address ((void *) p);
+#ifdef VM
+		do
+			if (write)
+				*p = *p;
+			else
+				(void) *p;
+		while (!vm_pin_page (upage));
+#else
+		if (write)
+			*p = *p;
+		else
+			(void) *p;
+#endif
+	}
+}
+
+/* Unpins the pages pinned by pin_buffer (BUFFER, SIZE, ...). */
+void
+unpin_buffer (void *buffer UNUSED, size_t size UNUSED) {
+#ifdef VM
+	uint8_t *upage;
+
+	for (upage = pg_round_down (buffer); upage < (uint8_t *) buffer + size;
+			upage += PGSIZE)
+		vm_unpin_page (upage);
+#endif
+}
+
 static struct file *find_file_by_fd(int fd) {
     struct thread *curr = thread_current();
     if (fd < 2 || fd >= FDT_COUNT_LIMIT) {
@@ -334,9 +395,19 @@ read (int fd, void *buffer, unsigned size) {
 			exit(-1);
 		}
 #endif
-		lock_acquire(&file_rw_lock);
-		bytes_read = file_read(file, buffer, size);
-		lock_release(&file_rw_lock);
+		while (size > 0) {
+			unsigned chunk = size < PIN_MAX ? size : PIN_MAX;
+			int n;
+
+			pin_buffer (ptr, chunk, true);
+			n = file_read (file, ptr, chunk);
+			unpin_buffer (ptr, chunk);
+			bytes_read += n;
+			ptr += n;
+			size -= n;
+			if (n < (int) chunk)
+				break;
+		}
 	}
 	return bytes_read;
 }
@@ -361,9 +432,21 @@ write (int fd, const void *buffer, unsigned size) {
 		if (inode_isdir(file->inode)) {
 			return -1;
 		}
-		lock_acquire(&file_rw_lock);
-		bytes_write = file_write(file, buffer, size);
-		lock_release(&file_rw_lock);
+		const char *ptr = buffer;
+
+		while (size > 0) {
+			unsigned chunk = size < PIN_MAX ? size : PIN_MAX;
+			int n;
+
+			pin_buffer ((void *) ptr, chunk, false);
+			n = file_write (file, ptr, chunk);
+			unpin_buffer ((void *) ptr, chunk);
+			bytes_write += n;
+			ptr += n;
+			size -= n;
+			if (n < (int) chunk)
+				break;
+		}
 	}
 	return bytes_write;
 }
@@ -585,4 +668,42 @@ symlink (const char *target, const char *linkpath) {
 	dir_close (subdir_tar);
 	free_path(path_tar);
 	return 0;
-}
\ No newline at end of file
+}
+
+/* Copies the scheduling statistics of process PID, or of the
+   calling process if PID is 0, to ST.  Returns false if there is
+   no such process. */
+bool
+schedstat (int pid, struct schedstat *st) {
+	struct schedstat buf;
+
+	check_address (st);
+	check_address ((uint8_t *) st + sizeof *st - 1);
+	if (!thread_get_schedstat (pid != 0 ? pid : thread_tid (), &buf))
+		return false;
+	memcpy (st, &buf, sizeof buf);
+	return true;
+}
+
+/* Waits on or wakes threads waiting on the futex at ADDR,
+   according to OP.  See <futex.h>. */
+int
+futex (int *addr, int op, int val, int64_t timeout, int *addr2) {
+	check_address (addr);
+	if ((uintptr_t) addr % sizeof *addr != 0)
+		return FUTEX_EINVAL;
+
+	switch (op) {
+		case FUTEX_WAIT:
+			return futex_wait (addr, val, timeout);
+		case FUTEX_WAKE:
+			return futex_wake (addr, val);
+		case FUTEX_REQUEUE:
+			check_address (addr2);
+			if ((uintptr_t) addr2 % sizeof *addr2 != 0)
+				return FUTEX_EINVAL;
+			return futex_requeue (addr, val, addr2, timeout);
+		default:
+			return FUTEX_EINVAL;
+	}
+}
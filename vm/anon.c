@@ -2,6 +2,8 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "threads/mmu.h"
+#include "threads/slab.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,6 +19,9 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Cache of swap table slots. */
+static struct kmem_cache *slot_cache;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
@@ -26,12 +31,14 @@ vm_anon_init (void) {
 	list_init(&swap_table);
 	lock_init(&swap_table_lock);
 
+	slot_cache = kmem_cache_create ("slot", sizeof (struct slot), NULL);
 	size_t swap_size = disk_size(swap_disk) / 8;
 	for (disk_sector_t i = 0; i < swap_size; i++)
 	{
-		struct slot *slot = (struct slot *)malloc(sizeof(struct slot));
+		struct slot *slot = kmem_cache_alloc (slot_cache);
 		slot->page = NULL;
 		slot->slot_no = i;
+		slot->ref_cnt = 0;
 		lock_acquire(&swap_table_lock);
 		list_push_back(&swap_table, &slot->swap_elem);
 		lock_release(&swap_table_lock);
@@ -68,7 +75,9 @@ anon_swap_in (struct page *page, void *kva) {
 			for (int i = 0; i < 8; i++) {
 				disk_read(swap_disk, page_slot_no * 8 + i, kva + DISK_SECTOR_SIZE * i);
 			}
-			slot->page = NULL;
+			// 다른 페이지들이 아직 이 slot을 공유하고 있으면 남겨 둔다
+			if (--slot->ref_cnt == 0)
+				slot->page = NULL;
 			anon_page->slot_no = -1;
 
 			lock_release(&swap_table_lock);
@@ -79,11 +88,13 @@ anon_swap_in (struct page *page, void *kva) {
 	return false;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.
+ * Every page that shares PAGE's frame goes out with it, into the same
+ * slot.  The caller must hold frame_table_lock. */
 static bool
 anon_swap_out (struct page *page) {
 	if (page == NULL) return false;
-	struct anon_page *anon_page = &page->anon;
+	struct frame *frame = page->frame;
 
 	struct list_elem *e;
 	struct slot *slot;
@@ -94,15 +105,42 @@ anon_swap_out (struct page *page) {
 		slot = list_entry(e, struct slot, swap_elem);
 		if (slot->page == NULL) {
 			for (int i = 0; i < 8; i++) {
-				disk_write(swap_disk, slot->slot_no * 8 + i, page->va + DISK_SECTOR_SIZE * i);
+				disk_write(swap_disk, slot->slot_no * 8 + i, frame->kva + DISK_SECTOR_SIZE * i);
 			}
-			anon_page->slot_no = slot->slot_no;
 			slot->page = page;
+			slot->ref_cnt = frame->ref_cnt;
+
+			for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+			{
+				struct page *p = list_entry(e, struct page, share_elem);
+				p->anon.slot_no = slot->slot_no;
+				p->frame = NULL;
+				pml4_clear_page(p->owner->pml4, p->va);
+			}
+			lock_release(&swap_table_lock);
+			return true;
+		}
+	}
+	lock_release(&swap_table_lock);
+	return false;
+}
+
+/* Makes DST, an anonymous page that is not yet in memory, share the
+ * swap slot of SRC, which is swapped out.  fork() uses this to copy a
+ * page the parent has swapped out without reading it back. */
+bool
+anon_swap_share (struct page *src, struct page *dst) {
+	struct list_elem *e;
 
-			page->frame->page = NULL;
-			page->frame = NULL;
+	ASSERT (src->frame == NULL);
 
-			pml4_clear_page(thread_current()->pml4, page->va);
+	lock_acquire(&swap_table_lock);
+	for (e = list_begin(&swap_table); e != list_end(&swap_table); e = list_next(e))
+	{
+		struct slot *slot = list_entry(e, struct slot, swap_elem);
+		if (slot->slot_no == src->anon.slot_no) {
+			slot->ref_cnt++;
+			dst->anon.slot_no = slot->slot_no;
 			lock_release(&swap_table_lock);
 			return true;
 		}
@@ -118,12 +156,15 @@ anon_destroy (struct page *page) {
 	struct list_elem *e;
 	struct slot *slot;
 
+	vm_frame_release(page);
+
 	lock_acquire(&swap_table_lock);
 	for (e = list_begin(&swap_table); e != list_end(&swap_table); e = list_next(e))
 	{
 		slot = list_entry(e, struct slot, swap_elem);
 		if (slot->slot_no == anon_page->slot_no) {
-			slot->page = NULL;
+			if (--slot->ref_cnt == 0)
+				slot->page = NULL;
 			break;
 		}
 	}
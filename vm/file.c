@@ -1,6 +1,8 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include "threads/mmu.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
 #include "userprog/process.h"
 
@@ -45,18 +47,30 @@ file_backed_swap_in (struct page *page, void *kva) {
 	return lazy_load_segment(page, file_page);
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.
+ * Every page that shares PAGE's frame, through an mmap() inherited
+ * across fork(), is unmapped with it.  The caller must hold
+ * frame_table_lock. */
 static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
+	struct frame *frame = page->frame;
+	struct list_elem *e;
+	bool dirty = false;
 
-	if (pml4_is_dirty(thread_current()->pml4, page->va)) {
-		file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->ofs);
-		pml4_set_dirty(thread_current()->pml4, page->va, 0);
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e)) {
+		struct page *p = list_entry(e, struct page, share_elem);
+		uint64_t *pml4 = p->owner->pml4;
+
+		if (pml4_is_dirty(pml4, p->va)) {
+			dirty = true;
+			pml4_set_dirty(pml4, p->va, 0);
+		}
+		p->frame = NULL;
+		pml4_clear_page(pml4, p->va);
 	}
-	page->frame->page = NULL;
-	page->frame = NULL;
-	pml4_clear_page(thread_current()->pml4, page->va);
+	if (dirty)
+		file_write_at(file_page->file, frame->kva, file_page->read_bytes, file_page->ofs);
 	return true;
 }
 
@@ -70,7 +84,7 @@ file_backed_destroy (struct page *page) {
         file_write_at(file_page->file, page->va, file_page->read_bytes, file_page->ofs);
         pml4_set_dirty(curr->pml4, page->va, 0);
     }
-    pml4_clear_page(curr->pml4, page->va);
+    vm_frame_release(page);
 }
 
 /* Do the mmap */
@@ -101,7 +115,7 @@ do_mmap (void *addr, size_t length, int writable,
         size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-        struct lazy_load_arg *lazy_load_arg = (struct lazy_load_arg *)malloc(sizeof(struct lazy_load_arg));
+        struct lazy_load_arg *lazy_load_arg = kmem_cache_alloc (lazy_load_arg_cache);
         lazy_load_arg->file = f;
         lazy_load_arg->ofs = offset;
         lazy_load_arg->read_bytes = page_read_bytes;
@@ -3,9 +3,17 @@
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "threads/mmu.h"
+#include "threads/slab.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "userprog/process.h"
 
+/* Object caches for the structures the fault path allocates. */
+static struct kmem_cache *vm_page_cache;
+static struct kmem_cache *frame_cache;
+struct kmem_cache *lazy_load_arg_cache;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -20,6 +28,10 @@ vm_init (void) {
 	/* TODO: Your code goes here. */
 	list_init(&frame_table);
 	lock_init(&frame_table_lock);
+	vm_page_cache = kmem_cache_create ("page", sizeof (struct page), NULL);
+	frame_cache = kmem_cache_create ("frame", sizeof (struct frame), NULL);
+	lazy_load_arg_cache = kmem_cache_create ("lazy_load_arg",
+			sizeof (struct lazy_load_arg), NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -40,6 +52,10 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static void frame_link (struct frame *, struct page *);
+static int frame_unlink (struct frame *, struct page *);
+static bool handle_fault (struct intr_frame *, void *addr, bool user,
+		bool write, bool not_present);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -57,7 +73,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		/* TODO: Create the page, fetch the initialier according to the VM type,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
-		struct page *p = (struct page *)malloc(sizeof(struct page));
+		struct page *p = kmem_cache_alloc (vm_page_cache);
 
 		typedef bool (*initializerFunc)(struct page *, enum vm_type, void *);
 		initializerFunc initializer = NULL;
@@ -72,6 +88,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		}
 		uninit_new(p, upage, init, type, aux, initializer);
 		p->writable = writable;
+		p->owner = thread_current ();
 
 		/* TODO: Insert the page into the spt. */
 		return spt_insert_page(spt, p);
@@ -84,13 +101,12 @@ err:
 struct page *
 spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 	/* TODO: Fill this function. */
-	struct page *page = (struct page *)malloc(sizeof(struct page));
-	page->va = pg_round_down(va);
+	struct page page;
+	page.va = pg_round_down(va);
 
 	struct hash_elem *e;
-	e = hash_find(&spt->spt_hash, &page->hash_elem);
+	e = hash_find(&spt->spt_hash, &page.hash_elem);
 
-	free(page);
 	return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
 }
 
@@ -112,68 +128,95 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Get the struct frame, that will be evicted.
+ * Runs the clock over the frame table, clearing accessed bits on the way,
+ * and takes the first frame that has not been accessed since the last
+ * pass.  A frame shared copy-on-write counts as accessed if any of its
+ * pages was.  The caller must hold frame_table_lock. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
 	 /* TODO: The policy for eviction is up to you. */
-	struct thread *curr = thread_current();
+	struct list_elem *e;
+	int pass;
 
-	lock_acquire(&frame_table_lock);
-    struct list_elem *start = list_begin(&frame_table);
+	ASSERT (lock_held_by_current_thread (&frame_table_lock));
 
-	for (start; start != list_end(&frame_table); start = list_next(start)) 
-	{
-		victim = list_entry(start, struct frame, frame_elem);
-		if (victim->page == NULL) {
-			lock_release(&frame_table_lock);
-			return victim;
-		}
-		if (pml4_is_accessed(curr->pml4, victim->page->va))
-			pml4_set_accessed(curr->pml4, victim->page->va, 0);
-		else
+	for (pass = 0; pass < 2 && victim == NULL; pass++)
+		for (e = list_begin(&frame_table); e != list_end(&frame_table); e = list_next(e))
 		{
-			lock_release(&frame_table_lock);
-			return victim;
+			struct frame *f = list_entry(e, struct frame, frame_elem);
+			struct list_elem *pe;
+			bool accessed = false;
+
+			if (f->pinned || f->page == NULL)
+				continue;
+			for (pe = list_begin(&f->pages); pe != list_end(&f->pages); pe = list_next(pe))
+			{
+				struct page *p = list_entry(pe, struct page, share_elem);
+				if (pml4_is_accessed(p->owner->pml4, p->va)) {
+					pml4_set_accessed(p->owner->pml4, p->va, 0);
+					accessed = true;
+				}
+			}
+			if (!accessed)
+			{
+				victim = f;
+				break;
+			}
 		}
-	}
-	lock_release(&frame_table_lock);
+
+	if (victim == NULL)
+		PANIC ("no frame to evict");
 	return victim;
 }
 
 /* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+ * The frame is swapped out for all the pages that share it, and returned
+ * pinned, like a frame from vm_get_frame().  The caller must hold
+ * frame_table_lock. */
 static struct frame *
 vm_evict_frame (void) {
 	struct frame *victim = vm_get_victim ();
 	/* TODO: swap out the victim and return the evicted frame. */
-	if(victim->page) {
-		swap_out(victim->page);
-	}
+	if (!swap_out(victim->page))
+		PANIC ("out of swap space");
+
+	list_init(&victim->pages);
+	victim->ref_cnt = 0;
+	victim->page = NULL;
+	victim->pinned = true;
 	return victim;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * space.
+ * The frame is pinned, so that it is not evicted before the caller has
+ * filled it and mapped it; the caller unpins it then. */
 static struct frame *
 vm_get_frame (void) {
 	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
-	frame = (struct frame*)malloc(sizeof(struct frame));
+	frame = kmem_cache_alloc (frame_cache);
 	frame->kva = palloc_get_page(PAL_USER);
 
 	// If there is no page available in the frame
 	if (frame->kva == NULL) {  
+		kmem_cache_free (frame_cache, frame);
+		lock_acquire(&frame_table_lock);
 		frame = vm_evict_frame(); // 프레임 제거
-        frame->page = NULL;
+		lock_release(&frame_table_lock);
         return frame;
 	}
+	frame->page = NULL;
+	list_init(&frame->pages);
+	frame->ref_cnt = 0;
+	frame->pinned = true;
 	lock_acquire(&frame_table_lock);
 	list_push_back(&frame_table, &frame->frame_elem);
 	lock_release(&frame_table_lock);
-	frame->page = NULL;
 
 	ASSERT (frame != NULL);
 	ASSERT (frame->page == NULL);
@@ -186,14 +229,80 @@ vm_stack_growth (void *addr UNUSED) {
 	vm_alloc_page(VM_ANON | VM_MARKER_0, pg_round_down(addr), 1);
 }
 
-/* Handle the fault on write_protected page */
+/* Handle the fault on write_protected page.
+ * PAGE is writable but mapped read-only because it shares its frame with
+ * the pages of a parent or child process.  Gives PAGE a copy of the frame
+ * of its own, or, if the others have gone their own ways already, simply
+ * the frame itself. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	struct thread *curr = thread_current ();
+	struct frame *old, *frame;
+	bool last = false;
+
+	/* PAGE may have been swapped out since the fault.  Then swapping it
+	 * back in gives it a frame of its own. */
+	lock_acquire (&frame_table_lock);
+	old = page->frame;
+	if (old == NULL) {
+		lock_release (&frame_table_lock);
+		return vm_do_claim_page (page);
+	}
+	if (old->ref_cnt == 1) {
+		pml4_clear_page (curr->pml4, page->va);
+		pml4_set_page (curr->pml4, page->va, old->kva, true);
+		lock_release (&frame_table_lock);
+		return true;
+	}
+	lock_release (&frame_table_lock);
+
+	frame = vm_get_frame ();
+
+	lock_acquire (&frame_table_lock);
+	old = page->frame;
+	if (old != NULL) {
+		copy_page (frame->kva, old->kva);
+		if (frame_unlink (old, page) == 0) {
+			list_remove (&old->frame_elem);
+			last = true;
+		}
+	}
+	frame_link (frame, page);
+	pml4_clear_page (curr->pml4, page->va);
+	pml4_set_page (curr->pml4, page->va, frame->kva, true);
+	if (old != NULL)
+		frame->pinned = false;
+	lock_release (&frame_table_lock);
+
+	if (last) {
+		palloc_free_page (old->kva);
+		kmem_cache_free (frame_cache, old);
+	}
+
+	/* Evicting for the new frame swapped PAGE out. */
+	if (old == NULL) {
+		if (!swap_in (page, frame->kva))
+			return false;
+		frame->pinned = false;
+	}
+	return true;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	bool handled;
+
+	TRACE (FAULT_ENTER, addr, user | write << 1 | not_present << 2);
+	handled = handle_fault (f, addr, user, write, not_present);
+	TRACE (FAULT_EXIT, addr, handled);
+	return handled;
+}
+
+/* Does the work of vm_try_handle_fault(). */
+static bool
+handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
 	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
 	struct page *page = NULL;
@@ -226,6 +335,13 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 			return false;
 		return vm_do_claim_page(page);
 	}
+
+	/* 쓰기 금지된 페이지에 write 요청한 경우: copy-on-write */
+	if (write) {
+		page = spt_find_page(spt, addr);
+		if (page != NULL && page->writable)
+			return vm_handle_wp(page);
+	}
 	return false;
 }
 
@@ -234,7 +350,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	kmem_cache_free (vm_page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -248,20 +364,110 @@ vm_claim_page (void *va UNUSED) {
 	return vm_do_claim_page (page);
 }
 
+/* Pins the frame of the current process's page at VA, so that it is
+ * not evicted until vm_unpin_page(), and returns true, or returns false
+ * if the page is not present.  The caller touches the page first; it
+ * may have been evicted again since. */
+bool
+vm_pin_page (void *va) {
+	struct page *page;
+	bool pinned = false;
+
+	lock_acquire (&frame_table_lock);
+	page = spt_find_page (&thread_current ()->spt, va);
+	if (page != NULL && page->frame != NULL) {
+		page->frame->pinned = true;
+		pinned = true;
+	}
+	lock_release (&frame_table_lock);
+	return pinned;
+}
+
+/* Unpins the frame of the current process's page at VA, pinned by
+ * vm_pin_page(). */
+void
+vm_unpin_page (void *va) {
+	struct page *page;
+
+	lock_acquire (&frame_table_lock);
+	page = spt_find_page (&thread_current ()->spt, va);
+	if (page != NULL && page->frame != NULL)
+		page->frame->pinned = false;
+	lock_release (&frame_table_lock);
+}
+
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
 	struct frame *frame = vm_get_frame ();
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	lock_acquire(&frame_table_lock);
+	frame_link(frame, page);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 	struct thread *curr = thread_current();
 	pml4_set_page(curr->pml4, page->va, frame->kva, page->writable);
+	lock_release(&frame_table_lock);
+
+	if (!swap_in (page, frame->kva))
+		return false;
+	frame->pinned = false;
+	return true;
+}
 
-	return swap_in (page, frame->kva);
+/* Adds PAGE to the pages that map FRAME.
+ * The caller must hold frame_table_lock. */
+static void
+frame_link (struct frame *frame, struct page *page) {
+	list_push_back (&frame->pages, &page->share_elem);
+	frame->ref_cnt++;
+	if (frame->page == NULL)
+		frame->page = page;
+	page->frame = frame;
+}
+
+/* Removes PAGE from the pages that map FRAME and returns the number of
+ * pages still mapping it.  The caller must hold frame_table_lock. */
+static int
+frame_unlink (struct frame *frame, struct page *page) {
+	ASSERT (page->frame == frame);
+
+	list_remove (&page->share_elem);
+	frame->ref_cnt--;
+	if (frame->page == page)
+		frame->page = list_empty (&frame->pages) ? NULL
+			: list_entry (list_front (&frame->pages), struct page, share_elem);
+	page->frame = NULL;
+	return frame->ref_cnt;
+}
+
+/* Unmaps PAGE from its frame, if it has one, and frees the frame once no
+ * other page maps it.  The mapping is removed from the page table as
+ * well, so that pml4_destroy() will not free a frame that is still
+ * shared. */
+void
+vm_frame_release (struct page *page) {
+	struct frame *frame;
+	bool last;
+
+	lock_acquire (&frame_table_lock);
+	frame = page->frame;
+	if (frame == NULL) {
+		lock_release (&frame_table_lock);
+		return;
+	}
+	last = frame_unlink (frame, page) == 0;
+	if (last)
+		list_remove (&frame->frame_elem);
+	if (page->owner->pml4 != NULL)
+		pml4_clear_page (page->owner->pml4, page->va);
+	lock_release (&frame_table_lock);
+
+	if (last) {
+		palloc_free_page (frame->kva);
+		kmem_cache_free (frame_cache, frame);
+	}
 }
 
 /* Returns a hash value for page */
@@ -308,7 +514,7 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 
 		if (type == VM_FILE)
 		{
-			struct lazy_load_arg *file_aux = malloc(sizeof(struct lazy_load_arg));
+			struct lazy_load_arg *file_aux = kmem_cache_alloc (lazy_load_arg_cache);
 			file_aux->file = src_page->file.file;
 			file_aux->ofs = src_page->file.ofs;
 			file_aux->read_bytes = src_page->file.read_bytes;
@@ -319,22 +525,43 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 
 			struct page *file_page = spt_find_page(dst, upage);
 			file_backed_initializer(file_page, type, NULL);
-			file_page->frame = src_page->frame;
-			pml4_set_page(thread_current()->pml4, file_page->va, src_page->frame->kva, src_page->writable);
+			lock_acquire(&frame_table_lock);
+			if (src_page->frame != NULL) {
+				frame_link(src_page->frame, file_page);
+				pml4_set_page(thread_current()->pml4, file_page->va, src_page->frame->kva, src_page->writable);
+			}
+			lock_release(&frame_table_lock);
 			continue;
 
 		}
 
 		if (!vm_alloc_page(type, upage, writable)) // uninit page 생성 & 초기화
 			return false;
+		struct page *dst_page = spt_find_page(dst, upage);
+		anon_initializer(dst_page, type, NULL);
+
+		/* Share the frame read-only; the first write to it from either
+		 * side faults into vm_handle_wp(), which copies it then. */
+		lock_acquire(&frame_table_lock);
+		if (src_page->frame != NULL) {
+			struct frame *frame = src_page->frame;
+			bool ok = pml4_set_page(thread_current()->pml4, upage, frame->kva, false);
+
+			if (ok) {
+				frame_link(frame, dst_page);
+				if (writable)
+					pml4_set_page(src_page->owner->pml4, upage, frame->kva, false);
+			}
+			lock_release(&frame_table_lock);
+			if (!ok)
+				return false;
+			continue;
+		}
+		lock_release(&frame_table_lock);
 
-		// vm_claim_page으로 요청해서 매핑 & 페이지 타입에 맞게 초기화
-		if (!vm_claim_page(upage))
+		// swap out된 페이지는 swap slot을 공유한다
+		if (!anon_swap_share(src_page, dst_page))
 			return false;
-
-		// 매핑된 프레임에 내용 로딩
-		struct page *dst_page = spt_find_page(dst, upage);
-		memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
 	}
 	return true;
 }
@@ -351,5 +578,5 @@ void hash_page_destroy(struct hash_elem *e, void *aux)
 {
 	struct page *page = hash_entry(e, struct page, hash_elem);
 	destroy(page);
-	free(page);
+	kmem_cache_free (vm_page_cache, page);
 }
\ No newline at end of file